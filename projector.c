@@ -4,23 +4,76 @@
  *  run:      ./projector 0 1 > CubeWithSphere.pgm
  *  convert:  convert CubeWithSphere.pgm CubeWithSphere.jpeg
 */
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <stdint.h>
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+//the hot kernels are compiled for several instruction sets and selected at run time on x86 with GCC or Clang
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ISA_DISPATCH
+#include <immintrin.h>
+#endif
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <linux/perf_event.h>
+#endif
 #ifdef _OPENMP
 #include <omp.h>
 #else
 double omp_get_wtime( void ) { return 0; }
+int omp_get_thread_num( void ) { return 0; }
+int omp_get_max_threads( void ) { return 1; }
+#endif
+
+//profiling regions, compiled only with -DPROFILE
+#ifdef PROFILE
+#define PROFILE_BEGIN(start) const double start = omp_get_wtime()
+#define PROFILE_END(stage, start) recordTraceEvent(stage, start, omp_get_wtime())
+#define PROFILE_LAP(stageTime, stage, mark) { const double now = omp_get_wtime(); stageTime[stage] += now - mark; mark = now; }
+#else
+#define PROFILE_BEGIN(start)
+#define PROFILE_END(stage, start)
+#define PROFILE_LAP(stageTime, stage, mark)
 #endif
 
 #ifndef M_PI
 #define M_PI (3.14159265358979323846)
 #endif
 
-#define VOXEL_X 100             // voxel side along x-axis
-#define VOXEL_Y 100             // voxel side along y-axis
-#define VOXEL_Z 100             // voxel side along z-axis
+//target attributes of the instruction set variants of the hot kernels
+#ifdef ISA_DISPATCH
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+#else
+#define TARGET_SSE42
+#define TARGET_AVX2
+#define TARGET_AVX512
+#define KERNEL_INLINE static inline
+#endif
+
+//defines a kernel in each instruction set variant, 'DEFINE' is a macro taking the name and the target of a variant
+#define ISA_VARIANTS(DEFINE, name) DEFINE(name, ) DEFINE(name##Sse42, TARGET_SSE42) DEFINE(name##Avx2, TARGET_AVX2) DEFINE(name##Avx512, TARGET_AVX512)
+//table of the variants of a kernel, indexed by enum isa
+#define ISA_TABLE(name) {name, name##Sse42, name##Avx2, name##Avx512}
 
 #define PIXEL 85                // detector's pixel side lenght
 
@@ -30,6 +83,57 @@ double omp_get_wtime( void ) { return 0; }
 
 #define OBJ_BUFFER 100          //voxel coefficients buffer size
 
+#define TILE_SIDE 64            //side of the detector tiles of the tiled layout
+#define TRANSPOSE_BLOCK 4096    //number of values under which a layout transposition is no longer split
+#define PYRAMID_LEVELS 2        //number of binned levels of the pyramid: 2x2 and 4x4
+#define LOG_WINDOW_GAIN 1000    //contrast gain of the logarithmic window, the ratio between the slopes at black and white
+
+#define TOMO_FILTER_WIDTH 31    //half width of the ramp filter of the filtered tomosynthesis
+#define AGGREGATE_LEAF 8        //side under which a box of the hierarchical backprojection is no longer split
+#define AGGREGATE_MARGIN 1      //margin of the footprint of a box on a detector, in pixels
+#define AGGREGATE_TASK_VOXELS 32768 //number of voxels under which the halves of a box are not run as tasks
+
+#define FOURIER_OVERSAMPLING 2  //ratio between the side of the Fourier projector's grid and the object's side
+#define FFT_LINE_BLOCK 8        //number of lines gathered together by the Fourier transforms of a grid
+#define FOURIER_KERNEL_WIDTH 4  //width of the Fourier projector's interpolation kernel, in samples of the grid
+#define FOURIER_KERNEL_TABLE 1024 //number of tabulated values of the interpolation kernel over its half width
+
+#define N_BALLS 8               //number of balls of the calibration phantom
+#define BALL_RADIUS 0.025       //radius of the balls of the calibration phantom, relative to the object side
+#define BALL_HELIX_RADIUS 0.3   //radius of the helix of the calibration phantom, relative to the object side
+#define BALL_HELIX_HEIGHT 0.7   //height of the helix of the calibration phantom, relative to the object side
+
+#define N_COUNTERS 4            //number of hardware counters read in benchmark mode
+#define CACHE_LINE 64           //size of a cache line, in bytes
+
+#define PROBE_STREAM_LENGTH (1 << 23)  //length of the arrays of the bandwidth probe
+#define PROBE_CHAINS 12                 //number of independent multiply-add chains (vectors) of the throughput probe
+#define PROBE_ITERATIONS (1 << 20)      //length of the multiply-add chains of the throughput probe
+#define PROBE_RUNS 3                    //number of runs of each probe, the fastest is kept
+
+//traversal cost model: floating point operations and bytes moved from memory
+#define FLOPS_PER_RAY 40                //ray setup, ranges of indices and ray length
+#define FLOPS_PER_INTERSECTION 3        //plane coordinate and parametric value
+#define FLOPS_PER_SEGMENT 21            //segment length, midpoint, voxel indices and accumulation
+#define BYTES_PER_RAY 16                //read and write of the pixel's absorption
+#define BYTES_PER_SEGMENT 8             //read of the voxel's coefficient
+
+#define MAX_SPANS (N_BALLS + 2) //maximum number of spans of full voxels in a row of the object
+
+#define N_CALIBRATION_PARAMS 5          //number of fitted alignment parameters
+#define CALIBRATION_ITERATIONS 100      //maximum number of Levenberg-Marquardt iterations
+#define CALIBRATION_SEARCH 4            //margin (in pixels) of the window in which the projection of a ball is searched
+
+#define PREPROCESS_MIN_TRANSMISSION 1e-6    //lower bound of the transmission values before the -log conversion
+
+#define SERVER_QUEUE 64         //maximum number of queued jobs of the server
+#define SERVER_MAX_ARGS 256     //maximum number of arguments of a job
+#define SERVER_MAX_REQUEST 65536    //maximum size of a job request, in bytes
+#define SERVER_RECEIVE_TIMEOUT 5    //time (in seconds) given to a client to send its job
+
+#define MAX_SCENE_OBJECTS 64    //maximum number of objects of a scene
+#define BVH_LEAF_OBJECTS 2      //maximum number of objects in a leaf of the scene's bounding volume hierarchy
+
 //cartesian axis
 enum axis{
     X,
@@ -37,6 +141,55 @@ enum axis{
     Z
 };
 
+//layout of the array of projections
+enum layout{
+    PROJECTION,                 //[view][row][column]
+    SINOGRAM,                   //[row][view][column]
+    TILED                       //[view][TILE_SIDE x TILE_SIDE tile][row][column]
+};
+
+//mapping of the absorption values onto the grey levels of the output
+enum window{
+    LINEAR_WINDOW,
+    LOG_WINDOW,                 //log(1 + gain t), expands the low absorptions
+    GAMMA_WINDOW                //t^(1 / gamma)
+};
+
+//method computing the projections of the object
+enum projector{
+    SIDDON_PROJECTOR,           //exact ray tracing through the voxels
+    SHEAR_WARP_PROJECTOR,       //slices resampled onto a common plane and summed, then warped onto the detector
+    FOURIER_PROJECTOR           //slices of the object's Fourier transform transformed back, parallel beam only
+};
+
+//encoding of the printed pgm image
+enum pixelFormat{
+    ASCII_PIXELS,               //P2, 8 bits
+    BINARY_8BIT,                //P5, 8 bits
+    BINARY_16BIT                //P5, 16 bits, most significant byte first
+};
+
+//instruction set of the variants of the hot kernels
+enum isa{
+    ISA_DEFAULT,                //instruction set of the compiler's target
+    ISA_SSE42,
+    ISA_AVX2,                   //AVX2 and FMA
+    ISA_AVX512,                 //AVX-512 foundation
+    N_ISAS
+};
+
+//profiled stages
+enum stage{
+    STAGE_GENERATION,
+    STAGE_VIEW,
+    STAGE_RAY_SETUP,
+    STAGE_INTERSECTION,
+    STAGE_MERGE,
+    STAGE_ACCUMULATION,
+    STAGE_OUTPUT,
+    N_STAGES
+};
+
 //models a point of coordinates (x,y,z) in the cartesian coordinate system
 struct point
 {
@@ -45,6 +198,37 @@ struct point
     double z;
 };
 
+//models the misalignment of the scanner with respect to the nominal geometry
+struct alignment{
+    double offsetU;             //shift of the detector along its rows
+    double offsetV;             //shift of the detector along its columns
+    double tilt;                //in-plane rotation of the detector, in radians
+    double skew;                //deviation from a right angle of the angle between the detector's rows and columns, in radians
+    double sourceDistance;      //error of the distance between the source and the rotation axis
+};
+
+//models the geometry of an angular position: a pixel in row r and column c is located at origin + c colStep + r rowStep;
+//the pixels themselves are evaluated as the nominal geometry does, from the misaligned detector coordinates
+//x = axes[0] (u, v) + offset[0] and z = axes[1] (u, v) + offset[1] of the nominal column and row coordinates u and v,
+//placed at matrix (x, 0, z) + translation
+struct detectorFrame{
+    struct point source;
+    struct point origin;
+    struct point colStep;
+    struct point rowStep;
+    double axes[2][2];
+    double offset[2];
+    double matrix[3][3];
+    struct point translation;
+};
+
+//models the pose perturbation of an angular position, in the reference (0 degrees) coordinate system
+struct perturbation{
+    struct point sourceShift;
+    struct point detectorShift;
+    double detectorRotation[3];         //rotation of the detector about its center around the x, y and z axes, in radians
+};
+
 //models a structure containing the range of indices of the planes to compute the intersection with
 struct ranges{
     int minIndx;
@@ -53,6 +237,14 @@ struct ranges{
 
 double sin_table[1024], cos_table[1024];
 
+//rotation matrix of each angular position, maps the reference (0 degrees) geometry onto the position's geometry
+double view_matrix[1024][3][3];
+
+//voxel side along x, y and z axis
+int VOXEL_X = 100;
+int VOXEL_Y = 100;
+int VOXEL_Z = 100;
+
 int VOXEL_MAT;
 int DETECTOR;
 int DOD;
@@ -64,6 +256,9 @@ int nVoxel[3];
 //number of parallel planes alogn X axis [0], Y axis [1], Z axis [2]
 int nPlanes[3];
 
+//coordinates of the planes orthogonal to the y axis of a non-uniform grid, in ascending order, NULL for a uniform grid
+double *yPlaneCoordinates = NULL;
+
 //position of the top-left pixel of the detector relative to the center of the detector
 double elementOffset;
 
@@ -75,556 +270,4835 @@ int nSidePixels;
 //line passing between the source and the center of the detector
 int stationaryDetector = 0;
 
-void init_tables( void )
-{
-    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
-    assert(nTheta < sizeof(sin_table)/sizeof(sin_table[0]));
-    //iterates over each source  Ntheta
-    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
-        sin_table[positionIndex] = sin((AP / 2 - positionIndex * STEP_ANGLE) * M_PI / 180);
-        cos_table[positionIndex] = cos((AP / 2 - positionIndex * STEP_ANGLE) * M_PI / 180);
-    }
+//misalignment of the scanner used to compute the projections
+struct alignment scannerAlignment;
+
+//pose perturbation of each angular position
+struct perturbation view_perturbation[1024];
+
+//source position and detector frame of each angular position
+struct detectorFrame view_frame[1024];
+
+//axis along which the object is cut in sub-sections for each angular position, and the axis of the sub-sections being traced
+enum axis view_slabAxis[1024];
+enum axis slabAxis = Y;
+
+//flag enabling the report of the time spent in each stage
+int benchmark = 0;
+
+//instruction set of the kernels selected for the CPU, and the names of the instruction sets
+enum isa selectedIsa = ISA_DEFAULT;
+const char *isaNames[N_ISAS] = {"default", "sse4.2", "avx2", "avx512f"};
+
+//number of traced rays, ray-plane intersections and segments, used by the performance model
+double traversalRays = 0;
+double traversalIntersections = 0;
+double traversalSegments = 0;
+
+//layout in which the projections are computed
+enum layout projectionLayout = PROJECTION;
+
+//persistent state of each ray between the sub-sections of the object, two values per ray, NULL when not enabled
+double *rayStates = NULL;
+
+//flag replacing the cone beam by a parallel beam along the central ray of each position
+int parallelBeam = 0;
+
+//window, gamma, encoding and ordered dithering of the printed images
+enum window outputWindow = LINEAR_WINDOW;
+double outputGamma = 2.2;
+enum pixelFormat outputFormat = ASCII_PIXELS;
+int outputDither = 0;
+
+//prefix of the pgm images of the binned levels, NULL when no pyramid is written
+const char *pyramidPrefix = NULL;
+
+//angle (in degrees) between the rotation axis and the z axis, the axis is tilted towards the y axis;
+//a non-zero value gives a laminography geometry
+double tiltAngle = 0;
+
+/**
+ * Computes the linear map from the nominal to the misaligned detector coordinates: a shear followed by a rotation.
+ * 'a' is the alignment of the scanner.
+ * 'axes' is the 2x2 array on which to store the map.
+ */
+void getDetectorAxes(const struct alignment *a, double axes[2][2]){
+    const double c = cos(a->tilt);
+    const double s = sin(a->tilt);
+    const double shear = tan(a->skew);
+
+    axes[0][0] = c;
+    axes[0][1] = c * shear - s;
+    axes[1][0] = s;
+    axes[1][1] = s * shear + c;
 }
 
 /**
- * Returns the minimum value between 'a' and 'b'.
+ * Returns the point 'p' rotated by the rotation matrix of the index-th angular position.
  */
-int min(int a, int b){
-    return a < b ? a : b;
+struct point rotatePoint(struct point p, int index){
+    double (*m)[3] = view_matrix[index];
+    struct point rotated;
+
+    rotated.x = m[X][X] * p.x + m[X][Y] * p.y + m[X][Z] * p.z;
+    rotated.y = m[Y][X] * p.x + m[Y][Y] * p.y + m[Y][Z] * p.z;
+    rotated.z = m[Z][X] * p.x + m[Z][Y] * p.y + m[Z][Z] * p.z;
+
+    return rotated;
 }
 
 /**
- * Returns the minimum value between 'a', 'b' and 'c'
+ * Returns the rotation matrix about the x, y and z axes by the angles in 'angles' (radians), applied in this order.
+ * 'm' is the 3x3 array on which to store the matrix.
  */
-int min3(int a, int b, int c){
-    return min(a,min(b,c));
+void getRotationMatrix(const double angles[3], double m[3][3]){
+    const double cx = cos(angles[X]), sx = sin(angles[X]);
+    const double cy = cos(angles[Y]), sy = sin(angles[Y]);
+    const double cz = cos(angles[Z]), sz = sin(angles[Z]);
+
+    m[0][0] = cy * cz;  m[0][1] = sx * sy * cz - cx * sz;  m[0][2] = cx * sy * cz + sx * sz;
+    m[1][0] = cy * sz;  m[1][1] = sx * sy * sz + cx * cz;  m[1][2] = cx * sy * sz - sx * cz;
+    m[2][0] = -sy;      m[2][1] = sx * cy;                 m[2][2] = cx * cy;
 }
 
 /**
- * Generates a sub-section of a solid cubic object given its side length.
- * 'f' is the pointer to the array on which to store the sub-section.
- * 'nOfSlices' is the number of voxel along the Y axis.
- * 'offset' distance (in number of voxel) of the slices to be generated from the initial slice.
- * 'sideLength' length of the side of the cubic object
+ * Computes the source position and the detector frame of an angular position for a given scanner alignment,
+ * including the pose perturbations of the position.
+ * 'a' is the alignment of the scanner.
+ * 'index' is the index of the source position.
+ * 'detectorIndex' is the index of the detector position.
+ * 'frame' is the pointer to the structure on which to store the geometry.
 */
-void generateCubeSlice(double *f, int nOfSlices, int offset, int sideLength){
-    const int innerToOuterDiff = nVoxel[X] / 2 - sideLength / 2;
-    const int rightSide = innerToOuterDiff + sideLength;
+void getDetectorFrame(const struct alignment *a, int index, int detectorIndex, struct detectorFrame *frame){
+    const struct perturbation *sourcePose = &view_perturbation[index];
+    const struct perturbation *detectorPose = &view_perturbation[detectorIndex];
+    double axes[2][2], m[3][3];
+    getDetectorAxes(a, axes);
+    getRotationMatrix(detectorPose->detectorRotation, m);
 
-#pragma omp parallel for collapse(3) default(none) shared(f, nOfSlices, nVoxel, offset, sideLength, innerToOuterDiff, rightSide)
-    for(int n = 0 ; n < nOfSlices; n++){
-        for(int i = 0; i < nVoxel[Z]; i++){
-            for(int j = 0; j < nVoxel[X]; j++){
-                f[(nVoxel[Z]) * i + j + n * nVoxel[X] * nVoxel[Z]] = 0;
-                if( (i >= innerToOuterDiff) && (i <= rightSide) && (j >= innerToOuterDiff) && (j <= rightSide) && (n + offset >= innerToOuterDiff) && (n + offset <=  nVoxel[Y] - innerToOuterDiff)){
-                    f[(nVoxel[Z]) * i + j + n * nVoxel[X] * nVoxel[Z]] = 1.0;
-                } else {
-                    f[(nVoxel[Z]) * i + j + n * nVoxel[X] * nVoxel[Z]] = 0.0;
-                }
-            }
+    const struct point source = {
+        sourcePose->sourceShift.x,
+        DOS + a->sourceDistance + sourcePose->sourceShift.y,
+        sourcePose->sourceShift.z
+    };
+    //detector geometry relative to the center of the detector, before the perturbation
+    const struct point corner = {
+        -elementOffset * (axes[0][0] + axes[0][1]) + a->offsetU,
+        0,
+        -elementOffset * (axes[1][0] + axes[1][1]) + a->offsetV
+    };
+    const struct point colStep = {PIXEL * axes[0][0], 0, PIXEL * axes[1][0]};
+    const struct point rowStep = {PIXEL * axes[0][1], 0, PIXEL * axes[1][1]};
+    const struct point *vectors[3] = {&corner, &colStep, &rowStep};
+    struct point perturbed[3];
+
+    //rotates the detector about its center
+    for(int k = 0; k < 3; k++){
+        perturbed[k].x = m[0][0] * vectors[k]->x + m[0][1] * vectors[k]->y + m[0][2] * vectors[k]->z;
+        perturbed[k].y = m[1][0] * vectors[k]->x + m[1][1] * vectors[k]->y + m[1][2] * vectors[k]->z;
+        perturbed[k].z = m[2][0] * vectors[k]->x + m[2][1] * vectors[k]->y + m[2][2] * vectors[k]->z;
+    }
+    perturbed[0].x += detectorPose->detectorShift.x;
+    perturbed[0].y += detectorPose->detectorShift.y - DOD;
+    perturbed[0].z += detectorPose->detectorShift.z;
+
+    frame->source = rotatePoint(source, index);
+    frame->origin = rotatePoint(perturbed[0], detectorIndex);
+    frame->colStep = rotatePoint(perturbed[1], detectorIndex);
+    frame->rowStep = rotatePoint(perturbed[2], detectorIndex);
+
+    //without perturbation the matrix is the rotation of the position and the translation its image of (0, -DOD, 0),
+    //so that the pixels are computed exactly as the nominal geometry
+    const struct point translation = {detectorPose->detectorShift.x, detectorPose->detectorShift.y - DOD, detectorPose->detectorShift.z};
+    double (*rotation)[3] = view_matrix[detectorIndex];
+    memcpy(frame->axes, axes, sizeof(axes));
+    frame->offset[0] = a->offsetU;
+    frame->offset[1] = a->offsetV;
+    for(int i = 0; i < 3; i++){
+        for(int j = 0; j < 3; j++){
+            frame->matrix[i][j] = rotation[i][0] * m[0][j] + rotation[i][1] * m[1][j] + rotation[i][2] * m[2][j];
         }
     }
+    frame->translation = rotatePoint(translation, detectorIndex);
 }
 
 /**
- * Generates a sub-section of a solid spherical object given its diameter.
- * 'f' is the pointer to the array on which to store the sub-section.
- * 'nOfSlices' is the number of voxel along the Y axis.
- * 'offset' distance (in number of voxel) of the slices to be generated from the initial slice.
- * 'diameter' is the diameter of the sphere.
-*/
-void generateSphereSlice(double *f, int nOfSlices, int offset, int diameter)
+ * Returns the cartesian coordinates of the pixel in row 'r' and column 'c' of a detector frame, computed as the
+ * nominal geometry does: an unperturbed frame gives the same values whatever the alignment.
+ * 'frame' is the pointer to the frame.
+ */
+KERNEL_INLINE struct point getFramePixel(const struct detectorFrame *frame, int r, int c){
+    const double u = -elementOffset + PIXEL * c;
+    const double v = -elementOffset + PIXEL * r;
+    const double x = frame->axes[0][0] * u + frame->axes[0][1] * v + frame->offset[0];
+    const double z = frame->axes[1][0] * u + frame->axes[1][1] * v + frame->offset[1];
+    const struct point pixel = {
+        frame->matrix[X][X] * x + frame->translation.x + frame->matrix[X][Z] * z,
+        frame->matrix[Y][X] * x + frame->translation.y + frame->matrix[Y][Z] * z,
+        frame->matrix[Z][X] * x + frame->translation.z + frame->matrix[Z][Z] * z
+    };
+    return pixel;
+}
+
+void init_tables( void )
 {
-#pragma omp parallel for collapse(3) default(none) shared(f, nOfSlices, nVoxel, offset, diameter, VOXEL_MAT)
-    for (int n = 0; n < nOfSlices; n++) {
-        for (int r = 0; r < nVoxel[Z]; r++) {
-            for (int c = 0; c < nVoxel[X]; c++) {
-                struct point temp;
-                temp.y = -(VOXEL_MAT / 2) + (VOXEL_Y / 2) + (n + offset) * VOXEL_Y;
-                temp.x = -(VOXEL_MAT / 2) + (VOXEL_X / 2) + (c) * VOXEL_X;
-                temp.z = -(VOXEL_MAT / 2) + (VOXEL_Z / 2) + (r) * VOXEL_Z;
-                const double distance = sqrt(pow(temp.x, 2) + pow(temp.y, 2) + pow(temp.z, 2));
-                if(distance <= diameter && c < nVoxel[Z] / 2){
-                    f[(nVoxel[Z]) * r + c + n * nVoxel[X] * nVoxel[Z]] = 1;
-                } else {
-                    f[(nVoxel[Z]) * r + c + n * nVoxel[X] * nVoxel[Z]] = 0.0;
-                }
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    assert(nTheta < sizeof(sin_table)/sizeof(sin_table[0]));
+
+    //unit vector of the rotation axis
+    const double k[3] = {0, sin(tiltAngle * M_PI / 180), cos(tiltAngle * M_PI / 180)};
+    //iterates over each source  Ntheta
+    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+        const double s = sin((AP / 2 - positionIndex * STEP_ANGLE) * M_PI / 180);
+        const double c = cos((AP / 2 - positionIndex * STEP_ANGLE) * M_PI / 180);
+        sin_table[positionIndex] = s;
+        cos_table[positionIndex] = c;
+
+        //Rodrigues' rotation about 'k': R = cI + s[k]x + (1 - c)kk'
+        const double cross[3][3] = {
+            {    0, -k[Z],  k[Y]},
+            { k[Z],     0, -k[X]},
+            {-k[Y],  k[X],     0}
+        };
+        for(int i = 0; i < 3; i++){
+            for(int j = 0; j < 3; j++){
+                view_matrix[positionIndex][i][j] = (i == j ? c : 0) + s * cross[i][j] + (1 - c) * k[i] * k[j];
             }
         }
     }
+
+    //the pixels of each position are obtained from the frame, without any trigonometric function
+    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+        getDetectorFrame(&scannerAlignment, positionIndex, positionIndex, &view_frame[positionIndex]);
+    }
 }
 
+#ifdef PROFILE
+//name of each profiled stage, as shown in the trace
+const char *stageNames[N_STAGES] = {"generation", "view", "ray setup", "intersection", "merge", "accumulation", "output"};
+
+//models a profiled region executed by a thread
+struct traceEvent{
+    int stage;
+    double start;
+    double end;
+};
+
+//models the growable array of the regions recorded by a thread
+struct traceBuffer{
+    struct traceEvent *events;
+    int count;
+    int capacity;
+};
+
+struct traceBuffer *traceBuffers = NULL;
+int nTraceBuffers = 0;
+double traceOrigin;
+
 /**
- * Generates a sub-section of a solid cubic object with an internal spherical cavity.
- * 'f' is the pointer to the array on which to store the sub-section.
- * 'nOfSlices' is the number of voxel along the Y axis.
- * 'offset' distance (in number of voxel) of the slices to be generated from the initial slice.
- * 'sideLength' lenght of the side of the object.
-*/
-void generateCubeWithSphereSlice(double *f, int nOfSlices, int offset, int sideLength){
-    const int innerToOuterDiff = nVoxel[X] / 2 - sideLength / 2;
-    const int rightSide = innerToOuterDiff + sideLength;
-    const struct point sphereCenter = {-15000, -15000, 1500};
+ * Allocates a trace buffer for each thread, regions recorded before the call are discarded.
+ */
+void initTrace( void ){
+    nTraceBuffers = omp_get_max_threads();
+    traceBuffers = (struct traceBuffer*)calloc(nTraceBuffers, sizeof(struct traceBuffer));
+    traceOrigin = omp_get_wtime();
+}
 
-#pragma omp parallel for collapse(3) default(none) shared(f, nOfSlices, offset, sideLength, nVoxel, innerToOuterDiff, rightSide, sphereCenter, VOXEL_MAT)
-    for(int n = 0 ; n < nOfSlices; n++){
-        for(int i = 0; i < nVoxel[Z]; i++){
-            for(int j = 0; j < nVoxel[X]; j++){
-                f[(nVoxel[Z]) * i + j + n * nVoxel[X] * nVoxel[Z]] = 0;
-                if ( (i >= innerToOuterDiff) &&
-                     (i <= rightSide) &&
-                     (j >= innerToOuterDiff) &&
-                     (j <= rightSide) &&
-                     (n + offset >= innerToOuterDiff) &&
-                     (n + offset <=  nVoxel[Y] - innerToOuterDiff) ) {
-                    struct point temp;
-                    temp.y = -(VOXEL_MAT / 2) + (VOXEL_Y / 2) + (n + offset) * VOXEL_Y;
-                    temp.x = -(VOXEL_MAT / 2) + (VOXEL_X / 2) + (j) * VOXEL_X;
-                    temp.z = -(VOXEL_MAT / 2) + (VOXEL_Z / 2) + (i) * VOXEL_Z;
-                    const double distance = sqrt(pow(temp.x - sphereCenter.x, 2) + pow(temp.y - sphereCenter.y, 2) + pow(temp.z - sphereCenter.z, 2));
-                    if(distance > 10000)
-                        f[(nVoxel[Z]) * i + j + n * nVoxel[X] * nVoxel[Z]] = 1.0;
-                } else {
-                    f[(nVoxel[Z]) * i + j + n * nVoxel[X] * nVoxel[Z]] = 0.0;
-                }
-            }
-        }
+/**
+ * Records a region executed by the calling thread.
+ * 'stage' is the stage of the region.
+ * 'start' and 'end' are the times at which the region started and ended.
+ */
+void recordTraceEvent(int stage, double start, double end){
+    const int thread = omp_get_thread_num();
+    if(thread >= nTraceBuffers)
+        return;
+    struct traceBuffer *buffer = &traceBuffers[thread];
+    if(buffer->count == buffer->capacity){
+        buffer->capacity = buffer->capacity ? 2 * buffer->capacity : 1024;
+        buffer->events = (struct traceEvent*)realloc(buffer->events, sizeof(struct traceEvent) * buffer->capacity);
     }
+    buffer->events[buffer->count].stage = stage;
+    buffer->events[buffer->count].start = start;
+    buffer->events[buffer->count].end = end;
+    buffer->count++;
 }
 
 /**
- * returns the coordinate of a plane parallel to the YZ plane
- * 'index' is the index of the plane to be returned where '0' is the index of the smallest-valued coordinate plane
-*/
-double getXPlane(int index){
-    return -((VOXEL_MAT) / 2) + index * VOXEL_X;
+ * Records the stages accumulated by the calling thread while processing a detector row as consecutive regions.
+ * 'stageTime' is the array containing the time accumulated by each stage.
+ * 'start' is the time at which the first region starts.
+ */
+void recordTraceStages(const double *stageTime, double start){
+    for(int stage = STAGE_INTERSECTION; stage <= STAGE_ACCUMULATION; stage++){
+        recordTraceEvent(stage, start, start + stageTime[stage]);
+        start += stageTime[stage];
+    }
 }
 
 /**
- * returns the coordinate of a plane parallel to the XZ plane
- * 'index' is the index of the plane to be returned where '0' is the index of the smallest-valued coordinate plane
-*/
-double getYPlane(int index){
-    return -((VOXEL_MAT) / 2) + index * VOXEL_Y;
+ * Writes the recorded regions as a Chrome trace (JSON), with a timeline per thread, and releases the buffers.
+ * Returns 1 on success, 0 otherwise.
+ * 'path' is the path of the file.
+ */
+int writeTrace(const char *path){
+    FILE *file = fopen(path, "w");
+    if(!file){
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 0;
+    }
+    const char *separator = "";
+    fprintf(file, "{\"traceEvents\":[");
+    for(int thread = 0; thread < nTraceBuffers; thread++){
+        for(int i = 0; i < traceBuffers[thread].count; i++){
+            const struct traceEvent *e = &traceBuffers[thread].events[i];
+            fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3lf,\"dur\":%.3lf}",
+                    separator, stageNames[e->stage], thread, (e->start - traceOrigin) * 1e6, (e->end - e->start) * 1e6);
+            separator = ",";
+        }
+        free(traceBuffers[thread].events);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(file);
+    free(traceBuffers);
+    traceBuffers = NULL;
+    nTraceBuffers = 0;
+    return 1;
 }
+#endif
+
+//hardware counters read around each stage in benchmark mode
+const char *counterNames[N_COUNTERS] = {"cycles", "instructions", "LLC misses", "dTLB misses"};
+
+//models the hardware counters of a thread
+struct threadCounters{
+    int fd[N_COUNTERS];
+    uint64_t start[N_COUNTERS];
+    uint64_t total[N_STAGES][N_COUNTERS];
+};
+
+struct threadCounters *counters = NULL;
+int nCounterThreads = 0;
 
+#ifdef __linux__
 /**
- * returns the coordinate of a plane parallel to the XY plane
- * 'index' is the index of the plane to be returned where '0' is the index of the smallest-valued coordinate plane
-*/
-double getZPlane(int index){
-    return -((VOXEL_MAT) / 2) + index * VOXEL_Z;
+ * Reads the counters of the calling thread.
+ * Returns 1 on success, 0 otherwise.
+ * 'c' is the pointer to the counters of the thread.
+ * 'values' is the array on which to store the values.
+ */
+int readThreadCounters(struct threadCounters *c, uint64_t *values){
+    //the group is read at once: number of counters followed by their values
+    uint64_t buffer[1 + N_COUNTERS];
+    if(read(c->fd[0], buffer, sizeof(buffer)) != sizeof(buffer) || buffer[0] != N_COUNTERS)
+        return 0;
+    memcpy(values, buffer + 1, sizeof(uint64_t) * N_COUNTERS);
+    return 1;
 }
 
+/**
+ * Opens the group of hardware counters of the calling thread.
+ * Returns 1 on success, 0 otherwise.
+ * 'c' is the pointer to the counters of the thread.
+ */
+int openThreadCounters(struct threadCounters *c){
+    const uint32_t types[N_COUNTERS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE};
+    const uint64_t configs[N_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+    };
+
+    for(int k = 0; k < N_COUNTERS; k++){
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[k];
+        attr.config = configs[k];
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = k == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        //counts the calling thread on any cpu, the first counter leads the group
+        c->fd[k] = syscall(SYS_perf_event_open, &attr, 0, -1, k == 0 ? -1 : c->fd[0], 0);
+        if(c->fd[k] < 0){
+            for(int j = 0; j < k; j++){
+                close(c->fd[j]);
+            }
+            for(int j = 0; j < N_COUNTERS; j++){
+                c->fd[j] = -1;
+            }
+            return 0;
+        }
+    }
+    ioctl(c->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return 1;
+}
+#endif
 
 /**
- * Returns the maximum parametric value a, representing the last intersection between ray and object
- * 'a' is the array containing the parametrical value of the intersection between the ray and the object's side along each axis.
- * 'isParallel' as a value corrisponding to the axis to which the array is orthogonal, -1 otherwise.
-*/
-double getAMax(double a[3][2], int isParallel){
-    double tempMax[3];
-    double aMax = 1;
-    for(int i = 0; i < 3; i++){
-        if(i != isParallel)
-            tempMax[i] = a[i][0] > a[i][1] ? a[i][0] : a[i][1];
+ * Opens the hardware counters of each thread of the parallel regions.
+ * Returns 1 if the counters are available, 0 otherwise.
+ */
+int openCounters( void ){
+#ifdef __linux__
+    int opened = 0;
+    nCounterThreads = omp_get_max_threads();
+    counters = (struct threadCounters*)calloc(nCounterThreads, sizeof(struct threadCounters));
+#pragma omp parallel default(none) shared(counters) reduction(+:opened)
+    {
+        opened += openThreadCounters(&counters[omp_get_thread_num()]);
     }
-    for(int i = 0; i < 3; i++){
-        if(i != isParallel) /* TODO: aMax sembra il _minimo_ di una serie di valor, è ok? */
-            aMax = aMax < tempMax[i] ? aMax : tempMax[i];
+    if(opened == nCounterThreads)
+        return 1;
+#pragma omp parallel default(none) shared(counters)
+    {
+        struct threadCounters *c = &counters[omp_get_thread_num()];
+        for(int k = 0; c->fd[0] >= 0 && k < N_COUNTERS; k++){
+            close(c->fd[k]);
+        }
     }
-    return aMax;
+    free(counters);
+    counters = NULL;
+#endif
+    return 0;
 }
 
 /**
- * Returns the minimum parametric value a, representing the fist intersection between ray and object
- * 'a' is the array containing the parametrical value of the intersection between the ray and the object's side along each axis.
- * 'isParallel' has a value corrisponding to the axis to which the array is orthogonal, -1 otherwise.
-*/
-double getAMin(double a[3][2], int isParallel ){
-    double tempMin[3];
-    double aMin = 0;
-    for(int i = 0; i < 3; i++){
-        if(i != isParallel)
-            tempMin[i] = a[i][0] < a[i][1] ? a[i][0] : a[i][1];
-    }
-    for(int i = 0; i < 3; i++){
-        if(i != isParallel) /* aMin sembra il _massimo_ di una serie di valori, è ok? */
-            aMin = aMin > tempMin[i] ? aMin : tempMin[i];
+ * Starts counting a stage on each thread.
+ */
+void startCounters( void ){
+#ifdef __linux__
+    if(!counters)
+        return;
+#pragma omp parallel default(none) shared(counters)
+    {
+        struct threadCounters *c = &counters[omp_get_thread_num()];
+        readThreadCounters(c, c->start);
     }
-    return aMin;
+#endif
 }
 
 /**
- * Computes the parametrical value of the intersection between a ray and a plane given the coordinate of the plane.
- * Returns the axis to which the ray is orthogonal, -1 otherwise.
- * 'a' and 'b' are the components along the axis ortogonal to the plane of the two points defining the ray.
- * 'value' is the coordinate of the plane.
- * 'ax' is the axis orthogonal to the plane.
- * 'inters' is the parametrical value that identify the intersection point along the ray.
-*/
-int getIntersection(double a, double b, double *plane, int nPlanes, double *inters){
-    if(a - b != 0){
-        for(int i = 0; i < nPlanes; i++){
-            inters[i] = (plane[i] - a) / (b - a);
+ * Stops counting a stage on each thread and adds the counted events to the stage's totals.
+ * 'stage' is the counted stage.
+ */
+void stopCounters(int stage){
+#ifdef __linux__
+    if(!counters)
+        return;
+#pragma omp parallel default(none) shared(counters, stage)
+    {
+        struct threadCounters *c = &counters[omp_get_thread_num()];
+        uint64_t values[N_COUNTERS];
+        if(readThreadCounters(c, values)){
+            for(int k = 0; k < N_COUNTERS; k++){
+                c->total[stage][k] += values[k] - c->start[k];
+            }
         }
-        return 1;
     }
-    return 0;
+#endif
 }
 
 /**
- * Returns the range of indices of the planes.
- * 'source' and 'pixel' are the components along the axis ortogonal to the plane of the two points defining the ray .
- * 'isParallel'  has a value corrisponding to the axis to which the array is orthogonal, -1 otherwise.
- * 'aMin' is the minimum parametrical value of the intersection between the ray and the object.
- * 'aMax' is the maximum parametrical value of the intersection between the ray and the object.
- * 'ax' is the axis orthogonal to the plane.
-*/
-struct ranges getRangeOfIndex(const double source, const double pixel, int isParallel, double aMin, double aMax, enum axis ax){
-    struct ranges idxs;
-    double firstPlane, lastPlane;
-    int voxelDim;
-
-    if(ax == X){
-        voxelDim = VOXEL_X;
-        firstPlane = getXPlane(0);
-        lastPlane = getXPlane(nPlanes[X] - 1);
-    } else if( ax == Y){
-        voxelDim = VOXEL_Y;
-        firstPlane = getYPlane(0);
-        lastPlane = getYPlane(nPlanes[Y] - 1);
-    } else {
-        voxelDim = VOXEL_Z;
-        firstPlane = getZPlane(0);
-        lastPlane = getZPlane(nPlanes[Z] - 1);
+ * Prints on stderr the counters of a stage for each thread, their instructions per cycle and,
+ * if 'rays' is positive, the bytes read from memory per ray (last level cache misses times the cache line size).
+ * 'stage' is the reported stage.
+ * 'rays' is the number of rays traced by the stage.
+ */
+void reportCounters(int stage, double rays){
+    uint64_t sum[N_COUNTERS] = {0};
+    if(!counters)
+        return;
+    for(int thread = 0; thread < nCounterThreads; thread++){
+        const uint64_t *total = counters[thread].total[stage];
+        fprintf(stderr, "  thread %d:", thread);
+        for(int k = 0; k < N_COUNTERS; k++){
+            fprintf(stderr, " %s %llu", counterNames[k], (unsigned long long)total[k]);
+            sum[k] += total[k];
+        }
+        fprintf(stderr, " IPC %.2lf\n", total[0] ? (double)total[1] / total[0] : 0);
+    }
+    fprintf(stderr, "  total: IPC %.2lf", sum[0] ? (double)sum[1] / sum[0] : 0);
+    if(rays > 0){
+        fprintf(stderr, ", %.2lf bytes/ray, %.2lf dTLB misses/ray", sum[2] * CACHE_LINE / rays, sum[3] / rays);
     }
+    fprintf(stderr, "\n");
+}
 
-    //gets range of indeces of XZ parallel planes
-    if(isParallel != Y){
-        if(pixel - source >= 0){
-            idxs.minIndx = nPlanes[ax] - ceil((lastPlane - aMin * (pixel - source) - source) / voxelDim);
-            idxs.maxIndx = 1 + floor((aMax * (pixel - source) + source - firstPlane) / voxelDim);
-        } else {
-            idxs.minIndx = nPlanes[ax] - ceil((lastPlane - aMax * (pixel - source) - source) / voxelDim);
-            idxs.maxIndx = floor((aMin * (pixel - source) + source - firstPlane) / voxelDim);
+/**
+ * Closes the hardware counters of each thread.
+ */
+void closeCounters( void ){
+#ifdef __linux__
+    if(!counters)
+        return;
+#pragma omp parallel default(none) shared(counters)
+    {
+        struct threadCounters *c = &counters[omp_get_thread_num()];
+        for(int k = 0; k < N_COUNTERS; k++){
+            close(c->fd[k]);
         }
-    } else {
-        idxs.minIndx = 0;
-        idxs.maxIndx = 0;
     }
-    return idxs;
+    free(counters);
+    counters = NULL;
+#endif
 }
 
-
+//the probes are compiled with optimisations whatever the build's level, and the chains of the throughput probe are
+//unrolled, so that they stay in independent registers
+#if defined(__GNUC__) && !defined(__clang__)
+#define PROBE_OPTIMIZE __attribute__((optimize("O2")))
+#define PROBE_UNROLL _Pragma("GCC unroll 16")
+#elif defined(__clang__)
+#define PROBE_OPTIMIZE
+#define PROBE_UNROLL _Pragma("unroll")
+#else
+#define PROBE_OPTIMIZE
+#define PROBE_UNROLL
+#endif
 
 /**
- * Computes each parametric value of the intersection between the ray and the planes whose index is in the range planeIndexRange.
- * 'source' and 'pixel' are the components along the axis ortogonal to the plane of the two points defining the ray .
- * 'planeIndexRange' is a structure containing the ranges of indeces of planes.
- * 'a' is a pointer to the array on which to store the parametrical values.
- * 'ax' is the axis orthogonal to the set of planes to which compute the intersection.
+ * Runs independent chains of multiplies and adds, with SSE2 vectors when available.
+ * Returns the number of floating point operations executed.
+ * 'checksum' is the pointer on which to add the sum of the chains.
 */
-void getAllIntersections(const double source, const double pixel, const struct ranges planeIndexRange, double *a, enum axis ax){
-    int start = 0, end = 0;
-    double d;
-
-    start = planeIndexRange.minIndx;
-    end = planeIndexRange.maxIndx;
-    double plane[end - start];
-    if(ax == X){
-        plane[0] = getXPlane(start);
-        d = VOXEL_X;
-        if(pixel - source < 0){
-            plane[0] = getXPlane(end);
-            d = -VOXEL_X;
-        }
-    } else if(ax == Y){
-        plane[0] = getYPlane(start);
-        d = VOXEL_Y;
-        if(pixel - source < 0){
-            plane[0] = getYPlane(end);
-            d = -VOXEL_Y;
+PROBE_OPTIMIZE double probeThroughput(double *checksum){
+#ifdef __SSE2__
+    const __m128d a = _mm_set1_pd(0.999999), b = _mm_set1_pd(1e-6);
+    __m128d x[PROBE_CHAINS];
+    for(int k = 0; k < PROBE_CHAINS; k++){
+        x[k] = _mm_set1_pd(k);
+    }
+    for(int i = 0; i < PROBE_ITERATIONS; i++){
+        PROBE_UNROLL
+        for(int k = 0; k < PROBE_CHAINS; k++){
+            x[k] = _mm_add_pd(_mm_mul_pd(x[k], a), b);
         }
-    } else if(ax == Z){
-        plane[0] = getZPlane(start);
-        d = VOXEL_Z;
-        if(pixel - source < 0){
-            plane[0] = getZPlane(end);
-            d = -VOXEL_Z;
+    }
+    double lanes[2];
+    for(int k = 0; k < PROBE_CHAINS; k++){
+        _mm_storeu_pd(lanes, x[k]);
+        *checksum += lanes[0] + lanes[1];
+    }
+    return 4.0 * PROBE_CHAINS * PROBE_ITERATIONS;
+#else
+    double x[PROBE_CHAINS];
+    for(int k = 0; k < PROBE_CHAINS; k++){
+        x[k] = k;
+    }
+    for(int i = 0; i < PROBE_ITERATIONS; i++){
+        PROBE_UNROLL
+        for(int k = 0; k < PROBE_CHAINS; k++){
+            x[k] = x[k] * 0.999999 + 1e-6;
         }
-    } else assert(0);
-
-    for (int i = 1; i < end - start; i++){
-        plane[i] = plane[i-1] + d;
     }
-    getIntersection(source, pixel, plane, end - start, a);
+    for(int k = 0; k < PROBE_CHAINS; k++){
+        *checksum += x[k];
+    }
+    return 2.0 * PROBE_CHAINS * PROBE_ITERATIONS;
+#endif
 }
 
-
+#ifdef ISA_DISPATCH
 /**
- * Merges two sorted arrays into one single sorted array.
- * Returns the length of the merged array.
- * 'a' is a pointer to a sorted array.
- * 'b' is a pointer to a sorted array.
- * 'lenA' is the length of the array pointed by 'a'
- * 'lenB' is the length of the array pointed by 'b'
- * 'c' is a pointer to the array to store the results.
+ * Runs independent chains of fused multiply-adds on 32 bytes vectors.
+ * Returns the number of floating point operations executed.
+ * 'checksum' is the pointer on which to add the sum of the chains.
 */
-int merge(double *a, double *b, int lenA, int lenB, double *c){
-    int i = 0;
-    int j = 0;
-    int k = 0;
-    while (j < lenA && k < lenB) {
-        if (a[j] < b[k]) {
-            c[i] = a[j];
-            j++;
-        } else {
-            c[i] = b[k];
-            k++;
-        }
-        i++;
+TARGET_AVX2 PROBE_OPTIMIZE double probeThroughputAvx2(double *checksum){
+    const __m256d a = _mm256_set1_pd(0.999999), b = _mm256_set1_pd(1e-6);
+    __m256d x[PROBE_CHAINS];
+    for(int k = 0; k < PROBE_CHAINS; k++){
+        x[k] = _mm256_set1_pd(k);
     }
-    while (j < lenA) {
-        c[i] = a[j];
-        i++;
-        j++;
+    for(int i = 0; i < PROBE_ITERATIONS; i++){
+        PROBE_UNROLL
+        for(int k = 0; k < PROBE_CHAINS; k++){
+            x[k] = _mm256_fmadd_pd(x[k], a, b);
+        }
     }
-    while (k < lenB) {
-        c[i] = b[k];
-        i++;
-        k++;
+    double lanes[4];
+    for(int k = 0; k < PROBE_CHAINS; k++){
+        _mm256_storeu_pd(lanes, x[k]);
+        *checksum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
     }
-    return lenA + lenB;
+    return 8.0 * PROBE_CHAINS * PROBE_ITERATIONS;
 }
 
 /**
- * Merges three sorted arrays into one single sorted array.
- * Returns the length of the merged array.
- * 'a' is a pointer to a sorted array.
- * 'b' is a pointer to a sorted array.
+ * Runs independent chains of fused multiply-adds on 64 bytes vectors.
+ * Returns the number of floating point operations executed.
+ * 'checksum' is the pointer on which to add the sum of the chains.
+*/
+TARGET_AVX512 PROBE_OPTIMIZE double probeThroughputAvx512(double *checksum){
+    const __m512d a = _mm512_set1_pd(0.999999), b = _mm512_set1_pd(1e-6);
+    __m512d x[PROBE_CHAINS];
+    for(int k = 0; k < PROBE_CHAINS; k++){
+        x[k] = _mm512_set1_pd(k);
+    }
+    for(int i = 0; i < PROBE_ITERATIONS; i++){
+        PROBE_UNROLL
+        for(int k = 0; k < PROBE_CHAINS; k++){
+            x[k] = _mm512_fmadd_pd(x[k], a, b);
+        }
+    }
+    for(int k = 0; k < PROBE_CHAINS; k++){
+        *checksum += _mm512_reduce_add_pd(x[k]);
+    }
+    return 16.0 * PROBE_CHAINS * PROBE_ITERATIONS;
+}
+
+//variants of the throughput probe, SSE4.2 adds nothing to the SSE2 arithmetic
+double (*probeThroughputVariants[N_ISAS])(double *) = {probeThroughput, probeThroughput, probeThroughputAvx2, probeThroughputAvx512};
+#else
+double (*probeThroughputVariants[N_ISAS])(double *) = {probeThroughput, probeThroughput, probeThroughput, probeThroughput};
+#endif
+
+/**
+ * Measures the peak floating point throughput and memory bandwidth reachable by this build,
+ * with a STREAM triad over arrays larger than the caches and with independent chains of multiply-adds
+ * in the widest vectors of the selected instruction set.
+ * 'flops' is the pointer on which to store the peak, in floating point operations per second.
+ * 'bandwidth' is the pointer on which to store the peak, in bytes per second.
+ */
+PROBE_OPTIMIZE void measurePeaks(double *flops, double *bandwidth){
+    const size_t length = PROBE_STREAM_LENGTH;
+    double *a = (double*)malloc(sizeof(double) * length);
+    double *b = (double*)malloc(sizeof(double) * length);
+    double *c = (double*)malloc(sizeof(double) * length);
+    double best = INFINITY;
+
+#pragma omp parallel for simd default(none) shared(a, b, c, length)
+    for(size_t i = 0; i < length; i++){
+        a[i] = 0;
+        b[i] = 1;
+        c[i] = 2;
+    }
+    for(int run = 0; run < PROBE_RUNS; run++){
+        const double start = omp_get_wtime();
+#pragma omp parallel for simd default(none) shared(a, b, c, length)
+        for(size_t i = 0; i < length; i++){
+            a[i] = b[i] + 3.0 * c[i];
+        }
+        best = fmin(best, omp_get_wtime() - start);
+    }
+    //the triad reads two arrays and writes one
+    *bandwidth = 3 * sizeof(double) * length / best;
+
+    best = INFINITY;
+    double checksum = 0, operations = 0;
+    double (*probe)(double *) = probeThroughputVariants[selectedIsa];
+    for(int run = 0; run < PROBE_RUNS; run++){
+        const double start = omp_get_wtime();
+        operations = 0;
+#pragma omp parallel default(none) shared(probe) reduction(+:checksum, operations)
+        operations += probe(&checksum);
+        best = fmin(best, omp_get_wtime() - start);
+    }
+    //the checksum keeps the chains from being optimised away
+    *flops = checksum != 0 ? operations / best : 0;
+
+    free(a);
+    free(b);
+    free(c);
+}
+
+/**
+ * Prints on stderr the achieved throughput and bandwidth of the traversal against the machine peaks
+ * and whether the traversal is compute-limited or bandwidth-limited.
+ * Operations and bytes are not measured: they are modelled from the number of rays, ray-plane intersections and segments
+ * with the fixed costs FLOPS_PER_* and BYTES_PER_*.
+ * 'time' is the time spent in the traversal.
+ * 'peakFlops' and 'peakBandwidth' are the machine peaks.
+ */
+void reportRoofline(double time, double peakFlops, double peakBandwidth){
+    const double flops = FLOPS_PER_RAY * traversalRays + FLOPS_PER_INTERSECTION * traversalIntersections + FLOPS_PER_SEGMENT * traversalSegments;
+    const double bytes = BYTES_PER_RAY * traversalRays + BYTES_PER_SEGMENT * traversalSegments;
+    const double intensity = flops / bytes;
+    const double ridge = peakFlops / peakBandwidth;
+    //attainable performance at the traversal's arithmetic intensity
+    const double roof = fmin(peakFlops, intensity * peakBandwidth);
+
+    fprintf(stderr,"Machine peaks: %.2lf GFLOP/s, %.2lf GB/s (ridge point %.2lf flop/byte)\n", peakFlops * 1e-9, peakBandwidth * 1e-9, ridge);
+    fprintf(stderr,"Traversal (modelled operations): %.2lf GFLOP/s, %.2lf GB/s, %.2lf flop/byte, %.1lf%% of the attainable %.2lf GFLOP/s, %s-limited\n",
+            flops / time * 1e-9, bytes / time * 1e-9, intensity, 100 * flops / time / roof, roof * 1e-9,
+            intensity < ridge ? "bandwidth" : "compute");
+}
+
+/**
+ * Returns the minimum value between 'a' and 'b'.
+ */
+int min(int a, int b){
+    return a < b ? a : b;
+}
+
+/**
+ * Returns the minimum value between 'a', 'b' and 'c'
+ */
+int min3(int a, int b, int c){
+    return min(a,min(b,c));
+}
+
+/**
+ * Returns the index of the pixel located in row 'r' and column 'c' of the index-th projection
+ * within an array of projections stored with the given layout.
+ * 'l' is the layout of the array.
+ * 'view' is the index of the projection.
+ * 'r' and 'c' are the row and the column of the pixel.
+*/
+size_t getPixelIndex(enum layout l, int view, int r, int c){
+    const int nViews = (int)(AP / STEP_ANGLE) + 1;
+    if(l == SINOGRAM){
+        return ((size_t)r * nViews + view) * nSidePixels + c;
+    } else if(l == TILED){
+        //tiles are stored band after band, tiles on the last band and column are cropped to the detector
+        const int band = r / TILE_SIDE;
+        const int tile = c / TILE_SIDE;
+        const int bandHeight = min(TILE_SIDE, nSidePixels - band * TILE_SIDE);
+        const int tileWidth = min(TILE_SIDE, nSidePixels - tile * TILE_SIDE);
+        return (size_t)view * nSidePixels * nSidePixels + (size_t)band * TILE_SIDE * nSidePixels
+                + (size_t)tile * TILE_SIDE * bandHeight + (r - band * TILE_SIDE) * tileWidth + (c - tile * TILE_SIDE);
+    }
+    return ((size_t)view * nSidePixels + r) * nSidePixels + c;
+}
+
+/**
+ * Swaps the two outer dimensions of an array of 'nA' x 'nB' runs of 'runLength' contiguous values,
+ * recursively splitting the larger dimension so that the copied blocks fit in any cache level.
+ * 'src' is the source array, stored as [nA][nB][runLength].
+ * 'dst' is the destination array, stored as [nB][nA][runLength].
+ * 'a0', 'a1', 'b0' and 'b1' delimit the block of runs to be copied.
+*/
+void transposeRuns(const double *src, double *dst, int nA, int nB, int runLength, int a0, int a1, int b0, int b1){
+    if((size_t)(a1 - a0) * (b1 - b0) * runLength <= TRANSPOSE_BLOCK){
+        for(int a = a0; a < a1; a++){
+            for(int b = b0; b < b1; b++){
+                memcpy(dst + ((size_t)b * nA + a) * runLength, src + ((size_t)a * nB + b) * runLength, sizeof(double) * runLength);
+            }
+        }
+    } else if(a1 - a0 >= b1 - b0){
+        const int aMid = (a0 + a1) / 2;
+#pragma omp task default(none) firstprivate(src, dst, nA, nB, runLength, a0, aMid, b0, b1)
+        transposeRuns(src, dst, nA, nB, runLength, a0, aMid, b0, b1);
+        transposeRuns(src, dst, nA, nB, runLength, aMid, a1, b0, b1);
+#pragma omp taskwait
+    } else {
+        const int bMid = (b0 + b1) / 2;
+#pragma omp task default(none) firstprivate(src, dst, nA, nB, runLength, a0, a1, b0, bMid)
+        transposeRuns(src, dst, nA, nB, runLength, a0, a1, b0, bMid);
+        transposeRuns(src, dst, nA, nB, runLength, a0, a1, bMid, b1);
+#pragma omp taskwait
+    }
+}
+
+/**
+ * Copies an array of projections into another array with a different layout.
+ * 'src' is the source array, stored with layout 'srcLayout'.
+ * 'dst' is the destination array, stored with layout 'dstLayout'.
+*/
+void convertLayout(const double *src, enum layout srcLayout, double *dst, enum layout dstLayout){
+    const int nViews = (int)(AP / STEP_ANGLE) + 1;
+
+    if(srcLayout == dstLayout){
+        memcpy(dst, src, sizeof(double) * nSidePixels * nSidePixels * nViews);
+    } else if(srcLayout != TILED && dstLayout != TILED){
+        //projection and sinogram order only differ by the order of the views and rows
+        const int nA = srcLayout == PROJECTION ? nViews : nSidePixels;
+        const int nB = srcLayout == PROJECTION ? nSidePixels : nViews;
+#pragma omp parallel default(none) shared(src, dst, nA, nB, nSidePixels)
+#pragma omp single
+        transposeRuns(src, dst, nA, nB, nSidePixels, 0, nA, 0, nB);
+    } else {
+        //copies each row a tile width at a time
+#pragma omp parallel for collapse(2) default(none) shared(src, srcLayout, dst, dstLayout, nViews, nSidePixels)
+        for(int view = 0; view < nViews; view++){
+            for(int r = 0; r < nSidePixels; r++){
+                for(int c = 0; c < nSidePixels; c += TILE_SIDE){
+                    const int runLength = min(TILE_SIDE, nSidePixels - c);
+                    memcpy(dst + getPixelIndex(dstLayout, view, r, c), src + getPixelIndex(srcLayout, view, r, c), sizeof(double) * runLength);
+                }
+            }
+        }
+    }
+}
+
+//models the header of published projections, followed by a ready flag per view and, at dataOffset, the projections
+struct publicationHeader{
+    char magic[8];              //"PROJPUB", written once the rest of the header is set
+    int32_t width;              //number of columns of the detector
+    int32_t height;             //number of rows of the detector
+    int32_t nViews;             //number of projections
+    int32_t layout;             //layout of the projections, as enum layout
+    uint64_t dataOffset;        //offset of the projections from the start of the segment, aligned to a page
+    double min;                 //minimum absorption, set once complete
+    double max;                 //maximum absorption, set once complete
+    int32_t complete;           //set to 1 once every view is ready and min and max are set
+    int32_t padding;
+};
+
+//mapping of the published projections, NULL when they are not published
+struct publicationHeader *publication = NULL;
+size_t publicationSize = 0;
+
+/**
+ * Creates the segment on which the projections are published and computed in place: a POSIX shared memory object when
+ * 'name' has the form "/name", a file otherwise.
+ * Returns the pointer to the projections within the mapping, zeroed, NULL on failure.
+ * 'nViews' is the number of projections.
+*/
+double *openPublication(const char *name, int nViews){
+#ifdef __linux__
+    const long page = sysconf(_SC_PAGESIZE);
+    const size_t headerSize = sizeof(struct publicationHeader) + sizeof(int32_t) * nViews;
+    const size_t dataOffset = (headerSize + page - 1) / page * page;
+    const size_t size = dataOffset + sizeof(double) * nSidePixels * nSidePixels * nViews;
+    const int isShared = name[0] == '/' && !strchr(name + 1, '/');
+    const int fd = isShared ? shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0600) : open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if(fd < 0){
+        perror(name);
+        return NULL;
+    }
+    void *segment = ftruncate(fd, size) ? MAP_FAILED : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(segment == MAP_FAILED){
+        perror(name);
+        return NULL;
+    }
+    //the new segment is zeroed: no view is ready
+    publication = (struct publicationHeader*)segment;
+    publicationSize = size;
+    publication->width = nSidePixels;
+    publication->height = nSidePixels;
+    publication->nViews = nViews;
+    publication->layout = projectionLayout;
+    publication->dataOffset = dataOffset;
+#pragma omp flush
+    memcpy(publication->magic, "PROJPUB", 8);
+    return (double*)((char*)segment + dataOffset);
+#else
+    fprintf(stderr,"Publishing %s requires Linux\n", name);
+    (void)nViews;
+    return NULL;
+#endif
+}
+
+/**
+ * Marks a published projection as final, consumers may read it while the next ones are computed.
+ * 'view' is the index of the projection.
+*/
+void markViewReady(int view){
+    if(!publication)
+        return;
+    int32_t *ready = (int32_t*)(publication + 1);
+#pragma omp flush
+#pragma omp atomic write
+    ready[view] = 1;
+}
+
+/**
+ * Marks every published projection as final and publishes the range of absorption.
+ * 'min' and 'max' are the minimum and maximum absorption.
+*/
+void completePublication(double min, double max){
+    if(!publication)
+        return;
+    for(int view = 0; view < publication->nViews; view++){
+        markViewReady(view);
+    }
+    publication->min = min;
+    publication->max = max;
+#pragma omp flush
+#pragma omp atomic write
+    publication->complete = 1;
+}
+
+/**
+ * Unmaps the published projections, the segment itself is left to the consumers.
+*/
+void closePublication( void ){
+#ifdef __linux__
+    if(publication)
+        munmap(publication, publicationSize);
+#endif
+    publication = NULL;
+    publicationSize = 0;
+}
+
+//models the uniform or non-uniform grid on which the objects are generated
+struct objectGrid{
+    int side;                   //side of the object along the x axis
+    double halfSide[3];         //half side of the object along each axis, the object being centered on the origin
+    int nVoxel[3];
+    const double *yPlanes;      //coordinates of the y planes of a non-uniform grid, NULL for a uniform grid
+};
+
+/**
+ * Returns the grid of the object being projected.
+ */
+struct objectGrid getObjectGrid( void ){
+    //the planes of every axis start from the same side, whatever the voxel sides
+    const struct objectGrid grid = {VOXEL_MAT, {VOXEL_MAT / 2, VOXEL_MAT / 2, VOXEL_MAT / 2}, {nVoxel[X], nVoxel[Y], nVoxel[Z]}, yPlaneCoordinates};
+    return grid;
+}
+
+/**
+ * Returns the center of the k-th ball of the calibration phantom, the balls lie on a helix around the z axis.
+ * 'side' is the side of the object.
+ */
+struct point getBallCenter(int k, int side){
+    const double angle = 2 * M_PI * k / N_BALLS;
+    struct point center;
+
+    center.x = BALL_HELIX_RADIUS * side * cos(angle);
+    center.y = BALL_HELIX_RADIUS * side * sin(angle);
+    center.z = BALL_HELIX_HEIGHT * side * ((double)k / (N_BALLS - 1) - 0.5);
+
+    return center;
+}
+
+/**
+ * Returns the coordinate of the center of the index-th voxel along an axis.
+ * 'grid' is the grid of the object.
+ * 'ax' is the axis.
+ */
+double getVoxelCenter(const struct objectGrid *grid, enum axis ax, int index){
+    const int voxelSide[3] = {VOXEL_X, VOXEL_Y, VOXEL_Z};
+    return -grid->halfSide[ax] + (voxelSide[ax] / 2) + index * voxelSide[ax];
+}
+
+/**
+ * Returns 1 if the center of the voxel in column 'c' of the row (y, z) of 'grid' is inside the sphere, 0 otherwise.
+ */
+int isInSphere(const struct objectGrid *grid, int c, double y, double z, struct point center, double radius){
+    const double x = getVoxelCenter(grid, X, c);
+    return sqrt(pow(x - center.x, 2) + pow(y - center.y, 2) + pow(z - center.z, 2)) <= radius;
+}
+
+/**
+ * Computes the span of columns of a row of voxels whose centers are inside a sphere.
+ * Returns 1 if the span is not empty, 0 otherwise.
+ * 'grid' is the grid of the object.
+ * 'y' and 'z' are the coordinates of the centers of the row's voxels.
+ * 'center' and 'radius' define the sphere.
+ * 'start' and 'end' are the pointers on which to store the first and one past the last column of the span.
+*/
+int getSphereSpan(const struct objectGrid *grid, double y, double z, struct point center, double radius, int *start, int *end){
+    const double squaredHalfChord = radius * radius - pow(y - center.y, 2) - pow(z - center.z, 2);
+    if(squaredHalfChord < 0)
+        return 0;
+    const double halfChord = sqrt(squaredHalfChord);
+    const double x0 = getVoxelCenter(grid, X, 0);
+    int first = (int)ceil((center.x - halfChord - x0) / VOXEL_X);
+    int last = (int)floor((center.x + halfChord - x0) / VOXEL_X);
+    first = first < 0 ? 0 : first;
+    last = min(last, grid->nVoxel[X] - 1);
+
+    //the bounds are refined with the exact test, so that rounding errors do not change the object
+    while(first > 0 && isInSphere(grid, first - 1, y, z, center, radius))
+        first--;
+    while(first <= last && !isInSphere(grid, first, y, z, center, radius))
+        first++;
+    while(last < grid->nVoxel[X] - 1 && isInSphere(grid, last + 1, y, z, center, radius))
+        last++;
+    while(last >= first && !isInSphere(grid, last, y, z, center, radius))
+        last--;
+
+    *start = first;
+    *end = last + 1;
+    return first <= last;
+}
+
+/**
+ * Computes the spans of columns of a row of voxels with unitary coefficient, the other voxels are empty.
+ * Returns the number of spans, sorted and not overlapping.
+ * 'grid' is the grid of the object.
+ * 'objectType' is the type of the object, as given on the command line.
+ * 'n' is the index of the row along the Y axis.
+ * 'i' is the index of the row along the Z axis.
+ * 'start' and 'end' are the arrays on which to store the first and one past the last column of each span.
+*/
+int getRowSpans(const struct objectGrid *grid, int objectType, int n, int i, int *start, int *end){
+    const double y = grid->yPlanes ? (grid->yPlanes[n] + grid->yPlanes[n + 1]) / 2 : getVoxelCenter(grid, Y, n);
+    const double z = getVoxelCenter(grid, Z, i);
+    int nSpans = 0;
+
+    if(objectType == 2){
+        //solid half sphere
+        const struct point center = {0, 0, 0};
+        if(getSphereSpan(grid, y, z, center, grid->side / 2, &start[0], &end[0])){
+            end[0] = min(end[0], grid->nVoxel[X] / 2);
+            nSpans = start[0] < end[0];
+        }
+    } else if(objectType == 4){
+        //calibration phantom, the spans of the balls are sorted and merged
+        const double radius = BALL_RADIUS * grid->side;
+        for(int k = 0; k < N_BALLS; k++){
+            int first, last;
+            if(getSphereSpan(grid, y, z, getBallCenter(k, grid->side), radius, &first, &last)){
+                int j = nSpans++;
+                while(j > 0 && start[j - 1] > first){
+                    start[j] = start[j - 1];
+                    end[j] = end[j - 1];
+                    j--;
+                }
+                start[j] = first;
+                end[j] = last;
+            }
+        }
+        int merged = 0;
+        for(int k = 1; k < nSpans; k++){
+            if(start[k] <= end[merged]){
+                end[merged] = end[merged] > end[k] ? end[merged] : end[k];
+            } else {
+                merged++;
+                start[merged] = start[k];
+                end[merged] = end[k];
+            }
+        }
+        nSpans = nSpans > 0 ? merged + 1 : 0;
+    } else {
+        //solid cube, with a spherical cavity for object type 1
+        const int sideLength = grid->nVoxel[X];
+        const int innerToOuterDiff = grid->nVoxel[X] / 2 - sideLength / 2;
+        const int rightSide = innerToOuterDiff + sideLength;
+        if( (i >= innerToOuterDiff) && (i <= grid->nVoxel[Z] - innerToOuterDiff) && (n >= innerToOuterDiff) && (n <= grid->nVoxel[Y] - innerToOuterDiff) ){
+            start[0] = innerToOuterDiff;
+            end[0] = min(rightSide + 1, grid->nVoxel[X]);
+            nSpans = 1;
+            int first, last;
+            const struct point sphereCenter = {-15000, -15000, 1500};
+            if(objectType == 1 && getSphereSpan(grid, y, z, sphereCenter, 10000, &first, &last) && first < end[0] && last > start[0]){
+                start[1] = last;
+                end[1] = end[0];
+                end[0] = first;
+                nSpans = 2;
+            }
+        }
+    }
+    return nSpans;
+}
+
+/**
+ * Fills an array with a value, using non-temporal stores when available so that the array does not evict the cache.
+ * 'p' is the pointer to the array.
+ * 'count' is the number of values to be written.
+ * 'value' is the value.
+*/
+void streamFill(double *p, int count, double value){
+    int i = 0;
+#ifdef __SSE2__
+    const __m128d packed = _mm_set1_pd(value);
+    //aligns the stores to 16 bytes
+    if(((uintptr_t)p & 15) && count > 0){
+        p[0] = value;
+        i = 1;
+    }
+    for(; i + 2 <= count; i += 2){
+        _mm_stream_pd(p + i, packed);
+    }
+#endif
+    for(; i < count; i++){
+        p[i] = value;
+    }
+}
+
+#ifdef ISA_DISPATCH
+/**
+ * Fills an array with a value using 32 bytes non-temporal stores.
+ * 'p' is the pointer to the array.
+ * 'count' is the number of values to be written.
+ * 'value' is the value.
+*/
+TARGET_AVX2 void streamFillAvx2(double *p, int count, double value){
+    const __m256d packed = _mm256_set1_pd(value);
+    int i = 0;
+    //aligns the stores to 32 bytes
+    for(; i < count && ((uintptr_t)(p + i) & 31); i++){
+        p[i] = value;
+    }
+    for(; i + 4 <= count; i += 4){
+        _mm256_stream_pd(p + i, packed);
+    }
+    for(; i < count; i++){
+        p[i] = value;
+    }
+}
+
+/**
+ * Fills an array with a value using 64 bytes (a cache line) non-temporal stores.
+ * 'p' is the pointer to the array.
+ * 'count' is the number of values to be written.
+ * 'value' is the value.
+*/
+TARGET_AVX512 void streamFillAvx512(double *p, int count, double value){
+    const __m512d packed = _mm512_set1_pd(value);
+    int i = 0;
+    //aligns the stores to 64 bytes
+    for(; i < count && ((uintptr_t)(p + i) & 63); i++){
+        p[i] = value;
+    }
+    for(; i + 8 <= count; i += 8){
+        _mm512_stream_pd(p + i, packed);
+    }
+    for(; i < count; i++){
+        p[i] = value;
+    }
+}
+
+//variants of the fill of the generation, SSE4.2 adds nothing to the SSE2 stores
+void (*streamFillVariants[N_ISAS])(double *, int, double) = {streamFill, streamFill, streamFillAvx2, streamFillAvx512};
+#else
+void (*streamFillVariants[N_ISAS])(double *, int, double) = {streamFill, streamFill, streamFill, streamFill};
+#endif
+
+//fill of the generation selected for the CPU
+void (*streamFillKernel)(double *, int, double) = streamFill;
+
+/**
+ * Generates a sub-section of an object a row of voxels at a time: each row is written once, as a sequence of spans
+ * of empty and full voxels.
+ * 'grid' is the grid of the object.
+ * 'f' is the pointer to the array on which to store the sub-section, stored as [y][z][x].
+ * 'nOfSlices' is the number of voxel along the Y axis, the slices past the last one of the object are left empty.
+ * 'offset' distance (in number of voxel) of the slices to be generated from the initial slice.
+ * 'objectType' is the type of the object: 1 cube with a spherical cavity, 2 half sphere, 4 calibration phantom, cube otherwise.
+*/
+void generateSlice(const struct objectGrid *grid, double *f, int nOfSlices, int offset, int objectType){
+#pragma omp parallel default(none) shared(f, nOfSlices, offset, objectType, grid, streamFillKernel)
+    {
+#pragma omp for collapse(2) schedule(static)
+        for(int n = 0; n < nOfSlices; n++){
+            for(int i = 0; i < grid->nVoxel[Z]; i++){
+                int start[MAX_SPANS], end[MAX_SPANS];
+                double *row = f + ((size_t)n * grid->nVoxel[Z] + i) * grid->nVoxel[X];
+                const int nSpans = n + offset < grid->nVoxel[Y] ? getRowSpans(grid, objectType, n + offset, i, start, end) : 0;
+                int written = 0;
+                for(int k = 0; k < nSpans; k++){
+                    streamFillKernel(row + written, start[k] - written, 0.0);
+                    streamFillKernel(row + start[k], end[k] - start[k], 1.0);
+                    written = end[k];
+                }
+                streamFillKernel(row + written, grid->nVoxel[X] - written, 0.0);
+            }
+        }
+#ifdef __SSE2__
+        //makes the non-temporal stores visible to the other threads
+        _mm_sfence();
+#endif
+    }
+}
+
+/**
+ * Computes a sub-section of the object cut along any axis, stored with the slab axis in place of the y axis:
+ * [x][z][y] for the x axis, [z][y][x] for the z axis, as generateSlice for the y axis.
+ * The voxels are found from the spans of the rows along x of the object.
+ * 'grid' is the grid of the object, with the slab axis in place of the y axis.
+ * 'f' is the array on which to store the coefficients.
+ * 'nOfSlices' is the number of slices of the sub-section.
+ * 'offset' is the index of the first slice along the slab axis.
+ * 'objectType' is the type of the object.
+ * 'ax' is the slab axis.
+*/
+void generateSlab(const struct objectGrid *grid, double *f, int nOfSlices, int offset, int objectType, enum axis ax){
+    if(ax == Y){
+        generateSlice(grid, f, nOfSlices, offset, objectType);
+    } else if(ax == Z){
+#pragma omp parallel for collapse(2) schedule(static) default(none) shared(f, nOfSlices, offset, objectType, grid, streamFillKernel)
+        for(int n = 0; n < nOfSlices; n++){
+            for(int j = 0; j < grid->nVoxel[Y]; j++){
+                int start[MAX_SPANS], end[MAX_SPANS];
+                double *row = f + ((size_t)n * grid->nVoxel[Y] + j) * grid->nVoxel[X];
+                const int nSpans = n + offset < grid->nVoxel[Z] ? getRowSpans(grid, objectType, j, n + offset, start, end) : 0;
+                int written = 0;
+                for(int k = 0; k < nSpans; k++){
+                    streamFillKernel(row + written, start[k] - written, 0.0);
+                    streamFillKernel(row + start[k], end[k] - start[k], 1.0);
+                    written = end[k];
+                }
+                streamFillKernel(row + written, grid->nVoxel[X] - written, 0.0);
+            }
+        }
+#ifdef __SSE2__
+        _mm_sfence();
+#endif
+    } else {
+        //the rows along x are scattered over the columns of the slab
+#pragma omp parallel for schedule(static) default(none) shared(f, nOfSlices, offset, objectType, grid)
+        for(int i = 0; i < grid->nVoxel[Z]; i++){
+            for(int n = 0; n < nOfSlices; n++){
+                memset(f + ((size_t)n * grid->nVoxel[Z] + i) * grid->nVoxel[Y], 0, sizeof(double) * grid->nVoxel[Y]);
+            }
+            for(int j = 0; j < grid->nVoxel[Y]; j++){
+                int start[MAX_SPANS], end[MAX_SPANS];
+                const int nSpans = getRowSpans(grid, objectType, j, i, start, end);
+                for(int k = 0; k < nSpans; k++){
+                    const int first = start[k] > offset ? start[k] : offset;
+                    const int last = min(end[k], offset + nOfSlices);
+                    for(int x = first; x < last; x++){
+                        f[((size_t)(x - offset) * grid->nVoxel[Z] + i) * grid->nVoxel[Y] + j] = 1.0;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Exchanges the y axis with 'ax' in the globals of the grid, so that the kernels trace sub-sections cut along 'ax'
+ * as sub-sections cut along y; calling it twice restores the grid.
+ */
+void swapSlabAxis(enum axis ax){
+    int *voxelSide[3] = {&VOXEL_X, &VOXEL_Y, &VOXEL_Z};
+    int t;
+    if(ax == Y)
+        return;
+    t = nVoxel[Y]; nVoxel[Y] = nVoxel[ax]; nVoxel[ax] = t;
+    t = nPlanes[Y]; nPlanes[Y] = nPlanes[ax]; nPlanes[ax] = t;
+    t = *voxelSide[Y]; *voxelSide[Y] = *voxelSide[ax]; *voxelSide[ax] = t;
+}
+
+/**
+ * Returns 'p' with its y component exchanged with the component along 'ax'.
+ */
+struct point swapPointAxis(struct point p, enum axis ax){
+    double *c[3] = {&p.x, &p.y, &p.z};
+    const double t = *c[Y];
+    *c[Y] = *c[ax];
+    *c[ax] = t;
+    return p;
+}
+
+/**
+ * Swaps the y coordinate of the points of a detector frame with their coordinate along the axis 'ax', as swapPointAxis.
+ * 'frame' is the pointer to the frame.
+ */
+void swapFrameAxis(struct detectorFrame *frame, enum axis ax){
+    frame->source = swapPointAxis(frame->source, ax);
+    frame->origin = swapPointAxis(frame->origin, ax);
+    frame->colStep = swapPointAxis(frame->colStep, ax);
+    frame->rowStep = swapPointAxis(frame->rowStep, ax);
+    frame->translation = swapPointAxis(frame->translation, ax);
+    for(int j = 0; j < 3; j++){
+        const double t = frame->matrix[Y][j];
+        frame->matrix[Y][j] = frame->matrix[ax][j];
+        frame->matrix[ax][j] = t;
+    }
+}
+
+/**
+ * Computes the direction of the ray from the source to the center of the detector.
+ * 'positionIndex' is the index of the angular position.
+ * 'd' is the array on which to store the direction.
+ */
+void getCentralRay(int positionIndex, double *d){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    const struct detectorFrame *frame = &view_frame[stationaryDetector ? nTheta / 2 : positionIndex];
+    const struct point source = view_frame[positionIndex].source;
+    const double center = (nSidePixels - 1) / 2.0;
+    d[X] = frame->origin.x + center * (frame->rowStep.x + frame->colStep.x) - source.x;
+    d[Y] = frame->origin.y + center * (frame->rowStep.y + frame->colStep.y) - source.y;
+    d[Z] = frame->origin.z + center * (frame->rowStep.z + frame->colStep.z) - source.z;
+}
+
+/**
+ * Chooses the axis along which the object is cut for each angular position: the axis crossed by the fewest planes
+ * along the central ray of the position, so that the rays cross as few sub-sections as possible; y is preferred on ties.
+ * 'adaptive' is 0 to cut the object along y for every position.
+ */
+void chooseSlabAxes(int adaptive){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    const int voxelSide[3] = {VOXEL_X, VOXEL_Y, VOXEL_Z};
+    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+        double d[3];
+        getCentralRay(positionIndex, d);
+        enum axis best = Y;
+        for(int ax = 0; adaptive && !yPlaneCoordinates && ax < 3; ax++){
+            if(fabs(d[ax]) / voxelSide[ax] < fabs(d[best]) / voxelSide[best])
+                best = ax;
+        }
+        view_slabAxis[positionIndex] = best;
+    }
+}
+
+/**
+ * returns the coordinate of a plane parallel to the YZ plane
+ * 'index' is the index of the plane to be returned where '0' is the index of the smallest-valued coordinate plane
+*/
+double getXPlane(int index){
+    return -((VOXEL_MAT) / 2) + index * VOXEL_X;
+}
+
+/**
+ * returns the coordinate of a plane parallel to the XZ plane
+ * 'index' is the index of the plane to be returned where '0' is the index of the smallest-valued coordinate plane
+*/
+double getYPlane(int index){
+    if(yPlaneCoordinates)
+        return yPlaneCoordinates[index];
+    return -((VOXEL_MAT) / 2) + index * VOXEL_Y;
+}
+
+/**
+ * returns the coordinate of a plane parallel to the XY plane
+ * 'index' is the index of the plane to be returned where '0' is the index of the smallest-valued coordinate plane
+*/
+double getZPlane(int index){
+    return -((VOXEL_MAT) / 2) + index * VOXEL_Z;
+}
+
+
+/**
+ * Computes the parametrical value of the intersection between a ray and a plane given the coordinate of the plane.
+ * Returns the axis to which the ray is orthogonal, -1 otherwise.
+ * 'a' and 'b' are the components along the axis ortogonal to the plane of the two points defining the ray.
+ * 'value' is the coordinate of the plane.
+ * 'ax' is the axis orthogonal to the plane.
+ * 'inters' is the parametrical value that identify the intersection point along the ray.
+*/
+int getIntersection(double a, double b, double *plane, int nPlanes, double *inters){
+    if(a - b != 0){
+        for(int i = 0; i < nPlanes; i++){
+            inters[i] = (plane[i] - a) / (b - a);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+//models the constants of the grid read by the traversal, hoisted out of the loops of the row kernels
+struct gridConstants{
+    int nVoxel[3];
+    int nPlanes[3];
+    double side[3];             //side of the voxels along each axis
+    double firstPlane[3];
+    double lastPlane[3];
+    double sliceStart;          //coordinate of the first y plane of the sub-section
+    int lastRow;                //last row along y of the sub-section, relative to the sub-section
+    int shift;                  //base 2 logarithm of the side of a power-of-two cubic grid
+};
+
+/**
+ * Reads the constants of the grid for the traversal of a sub-section of the object.
+ * Parameters known at compile time by the calling kernel replace the corresponding globals, so that they are folded.
+ * 'g' is the pointer to the structure on which to store the constants.
+ * 'slice' is the index of the sub-section of the object.
+ * 'fixedSide' is the number of voxels per side of a cubic grid known at compile time, 0 otherwise.
+ * 'cubic' is 1 if the grid is cubic, with cubic voxels.
+ * 'powerOfTwo' is 1 if the grid is cubic with a power-of-two side.
+*/
+KERNEL_INLINE void getGridConstants(struct gridConstants *g, int slice, const int fixedSide, const int cubic, const int powerOfTwo){
+    const int voxelSide[3] = {VOXEL_X, VOXEL_Y, VOXEL_Z};
+    const double firstPlane[3] = {getXPlane(0), getYPlane(0), getZPlane(0)};
+    for(int ax = 0; ax < 3; ax++){
+        g->nVoxel[ax] = fixedSide ? fixedSide : nVoxel[cubic ? X : ax];
+        g->nPlanes[ax] = fixedSide ? fixedSide + 1 : nPlanes[cubic ? X : ax];
+        g->side[ax] = voxelSide[cubic ? X : ax];
+        g->firstPlane[ax] = firstPlane[cubic ? X : ax];
+        g->lastPlane[ax] = g->firstPlane[ax] + (g->nPlanes[ax] - 1) * g->side[ax];
+    }
+    g->sliceStart = getYPlane(slice);
+    g->lastRow = min(g->nVoxel[Y] - 1, OBJ_BUFFER - 1);
+    g->shift = 0;
+    while(powerOfTwo && (1 << g->shift) < g->nVoxel[X])
+        g->shift++;
+}
+
+/**
+ * Returns the range of indices of the planes of the uniform grid crossed by the ray, the range is empty for an axis
+ * to which the ray is orthogonal.
+ * 'g' is the pointer to the constants of the grid.
+ * 'ax' is the axis orthogonal to the planes.
+ * 'source' and 'pixel' are the components along the axis ortogonal to the plane of the two points defining the ray .
+ * 'aMin' is the minimum parametrical value of the intersection between the ray and the object.
+ * 'aMax' is the maximum parametrical value of the intersection between the ray and the object.
+*/
+KERNEL_INLINE struct ranges getGridRangeOfIndex(const struct gridConstants *g, enum axis ax, const double source, const double pixel, double aMin, double aMax){
+    struct ranges idxs = {0, 0};
+
+    if(pixel - source > 0){
+        idxs.minIndx = g->nPlanes[ax] - ceil((g->lastPlane[ax] - aMin * (pixel - source) - source) / g->side[ax]);
+        idxs.maxIndx = 1 + floor((aMax * (pixel - source) + source - g->firstPlane[ax]) / g->side[ax]);
+    } else if(pixel - source < 0){
+        idxs.minIndx = g->nPlanes[ax] - ceil((g->lastPlane[ax] - aMax * (pixel - source) - source) / g->side[ax]);
+        idxs.maxIndx = floor((aMin * (pixel - source) + source - g->firstPlane[ax]) / g->side[ax]);
+    }
+    return idxs;
+}
+
+/**
+ * Returns the number of planes of the non-uniform y grid whose coordinate is below 'value', or not above it if 'inclusive'.
+ */
+int countYPlanesBelow(double value, int inclusive){
+    int lo = 0;
+    int hi = nPlanes[Y];
+    while(lo < hi){
+        const int mid = (lo + hi) / 2;
+        if(yPlaneCoordinates[mid] < value || (inclusive && yPlaneCoordinates[mid] == value)){
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Returns the range of indices of the planes of the non-uniform y grid crossed by the ray, in ascending order of coordinate.
+ * 'source' and 'pixel' are the components along the y axis of the two points defining the ray.
+ * 'aMin' is the minimum parametrical value of the intersection between the ray and the object.
+ * 'aMax' is the maximum parametrical value of the intersection between the ray and the object.
+*/
+struct ranges getRectilinearRangeOfIndex(const double source, const double pixel, double aMin, double aMax){
+    struct ranges idxs = {0, 0};
+    if(pixel - source != 0){
+        const double entry = source + aMin * (pixel - source);
+        const double exit = source + aMax * (pixel - source);
+        idxs.minIndx = countYPlanesBelow(fmin(entry, exit), 0);
+        idxs.maxIndx = countYPlanesBelow(fmax(entry, exit), 1);
+    }
+    return idxs;
+}
+
+/**
+ * Computes the parametric values of the intersections between the ray and the planes of the non-uniform y grid
+ * whose index is in the range planeIndexRange, in the order in which the ray crosses them.
+ * 'source' and 'pixel' are the components along the y axis of the two points defining the ray.
+ * 'planeIndexRange' is the range of indices returned by getRectilinearRangeOfIndex.
+ * 'a' is a pointer to the array on which to store the parametrical values.
+*/
+void getAllRectilinearIntersections(const double source, const double pixel, const struct ranges planeIndexRange, double *a){
+    const int length = planeIndexRange.maxIndx - planeIndexRange.minIndx;
+    if(length <= 0)
+        return;
+    if(pixel - source >= 0){
+        getIntersection(source, pixel, yPlaneCoordinates + planeIndexRange.minIndx, length, a);
+    } else {
+        double plane[length];
+        for(int i = 0; i < length; i++){
+            plane[i] = yPlaneCoordinates[planeIndexRange.maxIndx - 1 - i];
+        }
+        getIntersection(source, pixel, plane, length, a);
+    }
+}
+
+/**
+ * Computes each parametric value of the intersection between the ray and the planes of the uniform grid whose index
+ * is in the range planeIndexRange, in the order in which the ray crosses them.
+ * 'g' is the pointer to the constants of the grid.
+ * 'ax' is the axis orthogonal to the set of planes to which compute the intersection.
+ * 'source' and 'pixel' are the components along the axis ortogonal to the plane of the two points defining the ray .
+ * 'planeIndexRange' is a structure containing the ranges of indeces of planes.
+ * 'a' is a pointer to the array on which to store the parametrical values.
+*/
+KERNEL_INLINE void getGridIntersections(const struct gridConstants *g, enum axis ax, const double source, const double pixel, const struct ranges planeIndexRange, double *a){
+    const int length = planeIndexRange.maxIndx - planeIndexRange.minIndx;
+    double plane = g->firstPlane[ax] + planeIndexRange.minIndx * g->side[ax];
+    double step = g->side[ax];
+
+    if(pixel - source < 0){
+        plane = g->firstPlane[ax] + planeIndexRange.maxIndx * g->side[ax];
+        step = -g->side[ax];
+    }
+    for(int i = 0; i < length; i++){
+        a[i] = (plane - source) / (pixel - source);
+        plane += step;
+    }
+}
+
+
+/**
+ * Merges two sorted arrays into one single sorted array.
+ * Returns the length of the merged array.
+ * 'a' is a pointer to a sorted array.
+ * 'b' is a pointer to a sorted array.
+ * 'lenA' is the length of the array pointed by 'a'
+ * 'lenB' is the length of the array pointed by 'b'
+ * 'c' is a pointer to the array to store the results.
+*/
+int merge(double *a, double *b, int lenA, int lenB, double *c){
+    int i = 0;
+    int j = 0;
+    int k = 0;
+    while (j < lenA && k < lenB) {
+        if (a[j] < b[k]) {
+            c[i] = a[j];
+            j++;
+        } else {
+            c[i] = b[k];
+            k++;
+        }
+        i++;
+    }
+    while (j < lenA) {
+        c[i] = a[j];
+        i++;
+        j++;
+    }
+    while (k < lenB) {
+        c[i] = b[k];
+        i++;
+        k++;
+    }
+    return lenA + lenB;
+}
+
+/**
+ * Merges three sorted arrays into one single sorted array.
+ * Returns the length of the merged array.
+ * 'a' is a pointer to a sorted array.
+ * 'b' is a pointer to a sorted array.
  * 'c' is a pointer to a sorted array.
  * 'lenA' is the length of the array pointed by 'a'
  * 'lenB' is the length of the array pointed by 'b'
  * 'lenC' is the length of the array pointed by 'b'
  * 'merged' is a pointer to the array to store the results.
 */
-int merge3(double *a, double *b, double *c, int lenA, int lenB, int lenC, double *merged){
-    double ab[lenA + lenB];
-    merge(a, b, lenA, lenB, ab);
-    return merge(ab, c, lenA + lenB, lenC, merged);
+int merge3(double *a, double *b, double *c, int lenA, int lenB, int lenC, double *merged){
+    double ab[lenA + lenB + 1];
+    merge(a, b, lenA, lenB, ab);
+    return merge(ab, c, lenA + lenB, lenC, merged);
+}
+
+/**
+ * Returns the cartesian coordinates of the source.
+ * The reference position on the y-axis, rotated about the (possibly tilted) rotation axis, is precomputed by init_tables.
+ * 'index' is the index of the position starting from the position with the least angular distance from the y-axis.
+ */
+struct point getSource(int index){
+    return view_frame[index].source;
+}
+
+/**
+ * Returns the cartesian coordinates of a pixel located in row 'r' and column 'c' of the detector.
+ * The detector is located at index-th angular position.
+ * The pixel is obtained from the precomputed frame of the position, which includes alignment and pose perturbations.
+ * 'r' is the row of the pixel on the detector matrix.
+ * 'c' is the column of the pixel on the detector matrix.
+ * 'index' is the index of the position of the detector starting from the position with the 
+ * least angular distance from the y-axis.
+*/
+struct point getPixel(int r, int c, int index){
+    return getFramePixel(&view_frame[index], r, c);
+}
+
+/**
+ * Returns the planes of the object's sides orthogonal to the 'x' axis.
+ * 'planes' is the pointer to an array of two elements.
+ */
+void getSidesXPlanes(double *planes){
+    planes[0] = getXPlane(0);
+    planes[1] = getXPlane(nPlanes[X] - 1);
+}
+
+/**
+ * Returns the planes of the object's sides orthogonal to the 'y' axis.
+ * 'planes' is the pointer to an array of two elements.
+ */
+void getSidesYPlanes(double *planes, int slice){
+    planes[0] = getYPlane(slice);
+    planes[1] = getYPlane(min(nPlanes[Y] - 1, OBJ_BUFFER + slice));
+}
+
+/**
+ * Returns the planes of the object's sides orthogonal to the 'z' axis.
+ * 'planes' is the pointer to an array of two elements.
+ */
+void getSidesZPlanes(double *planes){
+    planes[0] = getZPlane(0);
+    planes[1] = getZPlane(nPlanes[Z] - 1);
+}
+
+/**
+ * Computes the pixel positions of a detector row and the parametric values of the entry and exit points of the rays
+ * into the sub-section of the object, for the whole row at once.
+ * The pixels are generated as getFramePixel, with the terms of the row computed once, so the row is produced as a single stream.
+ * With a persistent state, each ray keeps the parametric range [lo, hi] of the part of the object it has not crossed yet:
+ * the rays are clipped against the sides of the whole object in the first sub-section only, then each sub-section starts
+ * where the previous one ended and only its far y plane is intersected.
+ * 'source' is the position of the source.
+ * 'frame' is the frame of the detector.
+ * 'r' is the row of the detector.
+ * 'slice' is the index of the sub-section of the object.
+ * 'pixelX', 'pixelY' and 'pixelZ' are the arrays on which to store the coordinates of the pixels.
+ * 'aMin' and 'aMax' are the arrays on which to store the parametric values of the entry and exit points.
+ * 'state' is the array of the persistent state of the row's rays, two values per ray, NULL to clip each sub-section from scratch.
+ * 'beam' is the pointer to the direction of the rays of a parallel beam, each ray starting at its pixel minus the direction;
+ * NULL for the cone beam starting at 'source'.
+*/
+void setupRayRow(struct point source, const struct detectorFrame *frame, int r, int slice,
+                 double *pixelX, double *pixelY, double *pixelZ, double *aMin, double *aMax, double *state, const struct point *beam){
+    double sidesX[2], sidesY[2], sidesZ[2];
+    const double v = -elementOffset + PIXEL * r;
+    const double rowX = frame->axes[0][1] * v;
+    const double rowZ = frame->axes[1][1] * v;
+    const double (*m)[3] = frame->matrix;
+    const struct point t = frame->translation;
+    getSidesXPlanes(sidesX);
+    getSidesYPlanes(sidesY, slice);
+    getSidesZPlanes(sidesZ);
+
+#pragma omp simd
+    for(int c = 0; c < nSidePixels; c++){
+        const double u = -elementOffset + PIXEL * c;
+        const double x = frame->axes[0][0] * u + rowX + frame->offset[0];
+        const double z = frame->axes[1][0] * u + rowZ + frame->offset[1];
+        pixelX[c] = m[X][X] * x + t.x + m[X][Z] * z;
+        pixelY[c] = m[Y][X] * x + t.y + m[Y][Z] * z;
+        pixelZ[c] = m[Z][X] * x + t.z + m[Z][Z] * z;
+    }
+
+    if(!state || slice == 0){
+        //the persistent state starts from the sides of the whole object
+        if(state){
+            sidesY[0] = getYPlane(0);
+            sidesY[1] = getYPlane(nPlanes[Y] - 1);
+        }
+        //clips each ray against the sides of the sub-section, a ray orthogonal to an axis is only checked to lie between its sides
+#pragma omp simd
+        for(int c = 0; c < nSidePixels; c++){
+            const double s[3] = {
+                beam ? pixelX[c] - beam->x : source.x,
+                beam ? pixelY[c] - beam->y : source.y,
+                beam ? pixelZ[c] - beam->z : source.z
+            };
+            const double d[3] = {pixelX[c] - s[0], pixelY[c] - s[1], pixelZ[c] - s[2]};
+            const double *sides[3] = {sidesX, sidesY, sidesZ};
+            double lo = 0;
+            double hi = 1;
+            for(int ax = 0; ax < 3; ax++){
+                if(d[ax] != 0){
+                    const double a0 = (sides[ax][0] - s[ax]) / d[ax];
+                    const double a1 = (sides[ax][1] - s[ax]) / d[ax];
+                    lo = fmax(lo, fmin(a0, a1));
+                    hi = fmin(hi, fmax(a0, a1));
+                } else if(s[ax] < sides[ax][0] || s[ax] > sides[ax][1]){
+                    hi = 0;
+                }
+            }
+            aMin[c] = lo;
+            aMax[c] = hi;
+        }
+        if(!state)
+            return;
+        for(int c = 0; c < nSidePixels; c++){
+            state[2 * c] = aMin[c];
+            state[2 * c + 1] = aMax[c];
+        }
+        getSidesYPlanes(sidesY, slice);
+    }
+
+    //the near end of the sub-section is where the ray left the previous one, the far y plane bounds the other end;
+    //the range left to the ray is moved past the traced part. A ray parallel to the y planes is traced whole in the
+    //sub-section containing it, the last sub-section also containing the far side of the object
+    const int lastSlice = slice + OBJ_BUFFER >= nVoxel[Y];
+#pragma omp simd
+    for(int c = 0; c < nSidePixels; c++){
+        const double sy = beam ? pixelY[c] - beam->y : source.y;
+        const double dy = pixelY[c] - sy;
+        double lo = state[2 * c];
+        double hi = state[2 * c + 1];
+        if(dy > 0){
+            hi = fmin(hi, (sidesY[1] - sy) / dy);
+        } else if(dy < 0){
+            lo = fmax(lo, (sidesY[1] - sy) / dy);
+        } else if(sy < sidesY[0] || (sy >= sidesY[1] && !lastSlice)){
+            hi = lo;
+        }
+        aMin[c] = lo;
+        aMax[c] = hi;
+        if(lo < hi && dy > 0){
+            state[2 * c] = hi;
+        } else if(lo < hi && dy < 0){
+            state[2 * c + 1] = lo;
+        }
+    }
+}
+
+//models the data shared by the rows of a position, read by the row kernels
+struct rowTrace{
+    struct point source;
+    const struct detectorFrame *frame;
+    int positionIndex;
+    int slice;
+    double *f;
+    double *absorbment;
+    double *rayState;           //persistent state of the rays of the position, NULL when the sub-sections are traced independently
+    const struct point *beam;   //direction of the rays of a parallel beam, NULL for a cone beam
+};
+
+//models the range of absorption and the traversal counts accumulated by a row kernel
+struct traversalStats{
+    double amin;
+    double amax;
+    double nRays;
+    double nIntersections;
+    double nSegments;
+};
+
+/**
+ * Traces the rays of a detector row through a sub-section of the object and accumulates their absorption.
+ * The kernel is instantiated by ROW_KERNEL for the common grids and each instruction set: the parameters are compile-time
+ * constants of each instance, so that the constants of the grid are folded and the branches on the grid's kind are removed.
+ * 't' is the pointer to the data of the position.
+ * 'r' is the row of the detector.
+ * 'aX', 'aY', 'aZ' and 'aMerged' are the arrays on which to store the parametric values of the intersections.
+ * 'stats' is the pointer to the range of absorption and the traversal counts, updated by the kernel.
+ * 'fixedSide' is the number of voxels per side of a cubic grid known at compile time, 0 otherwise.
+ * 'cubic' is 1 if the grid is cubic, with cubic voxels.
+ * 'powerOfTwo' is 1 if the grid is cubic with a power-of-two side.
+ * 'rectilinear' is 1 if the planes orthogonal to the y axis are not uniform.
+ * 'weigh' is 1 to accumulate the weights of the projector instead of the absorption: the length of each segment is added
+ * to its voxel in 'f' (column sums) and to its pixel (row sums), the pixels being in projection order.
+*/
+KERNEL_INLINE void traceRowKernel(const struct rowTrace *t, int r, double *aX, double *aY, double *aZ, double *aMerged, struct traversalStats *stats,
+                                  const int fixedSide, const int cubic, const int powerOfTwo, const int rectilinear, const int weigh){
+    const struct point viewSource = t->source;
+    double pixelX[nSidePixels], pixelY[nSidePixels], pixelZ[nSidePixels];
+    double rowMin[nSidePixels], rowMax[nSidePixels];
+    struct gridConstants g;
+    getGridConstants(&g, t->slice, fixedSide, cubic, powerOfTwo);
+    const int lastRectilinearRow = min3(nVoxel[Y] - 1, OBJ_BUFFER + t->slice - 1, nPlanes[Y] - 2);
+
+    //computes pixel positions and Min-Max parametric values of the whole row
+    PROFILE_BEGIN(setupStart);
+    setupRayRow(viewSource, t->frame, r, t->slice, pixelX, pixelY, pixelZ, rowMin, rowMax,
+                t->rayState ? t->rayState + (size_t)2 * r * nSidePixels : NULL, t->beam);
+    PROFILE_END(STAGE_RAY_SETUP, setupStart);
+#ifdef PROFILE
+    //the stages of the row's pixels are accumulated and recorded once per row
+    double stageTime[N_STAGES] = {0};
+    double mark = omp_get_wtime();
+    const double rowStart = mark;
+#endif
+
+    for(int c = 0; c < nSidePixels; c++){
+        const struct point pixel = {pixelX[c], pixelY[c], pixelZ[c]};
+        //the rays of a parallel beam start from their own source
+        const struct point source = t->beam ? (struct point){pixel.x - t->beam->x, pixel.y - t->beam->y, pixel.z - t->beam->z} : viewSource;
+        const double aMin = rowMin[c];
+        const double aMax = rowMax[c];
+
+        if(aMin < aMax){
+            //computes Min-Max plane indexes
+            struct ranges indeces[3];
+            indeces[X] = getGridRangeOfIndex(&g, X, source.x, pixel.x, aMin, aMax);
+            indeces[Y] = rectilinear ? getRectilinearRangeOfIndex(source.y, pixel.y, aMin, aMax)
+                                     : getGridRangeOfIndex(&g, Y, source.y, pixel.y, aMin, aMax);
+            indeces[Z] = getGridRangeOfIndex(&g, Z, source.z, pixel.z, aMin, aMax);
+
+            //computes lenghts of the arrays containing parametric value of the intersection with each set of parallel planes
+            int lenX = indeces[X].maxIndx - indeces[X].minIndx;
+            int lenY = indeces[Y].maxIndx - indeces[Y].minIndx;
+            int lenZ = indeces[Z].maxIndx - indeces[Z].minIndx;
+            if(lenX < 0){
+                lenX = 0;
+            }
+            if(lenY < 0){
+                lenY = 0;
+            }
+            if(lenZ < 0){
+                lenZ = 0;
+            }
+            const int lenA = lenX + lenY + lenZ;
+            stats->nRays++;
+            stats->nIntersections += lenA;
+            stats->nSegments += lenA + 1;
+
+            //computes ray-planes intersection Nx + Ny + Nz
+            getGridIntersections(&g, X, source.x, pixel.x, indeces[X], aX);
+            if(rectilinear){
+                getAllRectilinearIntersections(source.y, pixel.y, indeces[Y], aY);
+            } else {
+                getGridIntersections(&g, Y, source.y, pixel.y, indeces[Y], aY);
+            }
+            getGridIntersections(&g, Z, source.z, pixel.z, indeces[Z], aZ);
+            PROFILE_LAP(stageTime, STAGE_INTERSECTION, mark);
+
+            //computes segments Nx + Ny + Nz, the entry and exit points bound the merged intersections so that the parts of
+            //the ray before the first and after the last plane crossed are traced even when a plane is missed by rounding
+            aMerged[0] = aMin;
+            merge3(aX, aY, aZ, lenX, lenY, lenZ, aMerged + 1);
+            aMerged[lenA + 1] = aMax;
+            PROFILE_LAP(stageTime, STAGE_MERGE, mark);
+
+            //associates each segment to the respective voxel Nx + Ny + Nz
+            const double d12 = sqrt(pow(pixel.x - source.x, 2) + pow(pixel.y - source.y, 2) + pow(pixel.z - source.z, 2));
+            double absorption = 0.0;
+            for(int i = 0; i < lenA + 1; i++){
+                const double segments = d12 * (aMerged[i + 1] - aMerged[i]);
+                const double aMid = (aMerged[i + 1] + aMerged[i]) / 2;
+                const int xRow = min((int)((source.x + aMid * (pixel.x - source.x) - g.firstPlane[X]) / g.side[X]), g.nVoxel[X] - 1);
+                const int zRow = min((int)((source.z + aMid * (pixel.z - source.z) - g.firstPlane[Z]) / g.side[Z]), g.nVoxel[Z] - 1);
+                int yRow;
+                if(rectilinear){
+                    //the rows of a non-uniform grid are found by binary search
+                    const int yPlane = countYPlanesBelow(source.y + aMid * (pixel.y - source.y), 1) - 1;
+                    yRow = (yPlane < t->slice ? t->slice : min(yPlane, lastRectilinearRow)) - t->slice;
+                } else {
+                    yRow = min((int)((source.y + aMid * (pixel.y - source.y) - g.sliceStart) / g.side[Y]), g.lastRow);
+                }
+                const size_t voxel = powerOfTwo ? ((((size_t)yRow << g.shift) + zRow) << g.shift) + xRow
+                                                : ((size_t)yRow * g.nVoxel[Z] + zRow) * g.nVoxel[X] + xRow;
+                if(weigh){
+                    //the rays of the other rows cross the same voxels
+#pragma omp atomic
+                    t->f[voxel] += segments;
+                    absorption += segments;
+                } else {
+                    absorption += t->f[voxel] * segments;
+                }
+            }
+            const size_t pixelIndex = getPixelIndex(weigh ? PROJECTION : projectionLayout, t->positionIndex, r, c);
+            t->absorbment[pixelIndex] += absorption;
+            stats->amax = fmax(stats->amax, t->absorbment[pixelIndex]);
+            stats->amin = fmin(stats->amin, t->absorbment[pixelIndex]);
+            PROFILE_LAP(stageTime, STAGE_ACCUMULATION, mark);
+        }
+    }
+#ifdef PROFILE
+    recordTraceStages(stageTime, rowStart);
+#endif
+}
+
+//instantiates the row kernel for a kind of grid and an instruction set
+#define ROW_KERNEL_VARIANT(name, target, fixedSide, cubic, powerOfTwo, rectilinear, weigh) \
+target void name(const struct rowTrace *t, int r, double *aX, double *aY, double *aZ, double *aMerged, struct traversalStats *stats){ \
+    traceRowKernel(t, r, aX, aY, aZ, aMerged, stats, fixedSide, cubic, powerOfTwo, rectilinear, weigh); \
+}
+
+//instantiates the row kernel for a kind of grid in each instruction set, and the table of the variants
+#define ROW_KERNEL(name, ...) \
+ROW_KERNEL_VARIANT(name, , __VA_ARGS__) \
+ROW_KERNEL_VARIANT(name##Sse42, TARGET_SSE42, __VA_ARGS__) \
+ROW_KERNEL_VARIANT(name##Avx2, TARGET_AVX2, __VA_ARGS__) \
+ROW_KERNEL_VARIANT(name##Avx512, TARGET_AVX512, __VA_ARGS__) \
+void (*name##Variants[N_ISAS])(const struct rowTrace *, int, double *, double *, double *, double *, struct traversalStats *) = ISA_TABLE(name);
+
+ROW_KERNEL(traceRowGeneric, 0, 0, 0, 0, 0)
+ROW_KERNEL(traceRowRectilinear, 0, 0, 0, 1, 0)
+ROW_KERNEL(traceRowCubic, 0, 1, 0, 0, 0)
+ROW_KERNEL(traceRowCubicPowerOfTwo, 0, 1, 1, 0, 0)
+#ifdef KERNEL_SIDE
+//cubic grid whose side is fixed at compile time with -DKERNEL_SIDE=n
+ROW_KERNEL(traceRowFixedSide, KERNEL_SIDE, 1, 0, 0, 0)
+#endif
+//the weights are computed once per geometry, the generic grids suffice
+ROW_KERNEL(weighRowGeneric, 0, 0, 0, 0, 1)
+ROW_KERNEL(weighRowRectilinear, 0, 0, 0, 1, 1)
+
+//row kernel selected for the grid of the run, and its name
+void (*traceRow)(const struct rowTrace *t, int r, double *aX, double *aY, double *aZ, double *aMerged, struct traversalStats *stats) = traceRowGeneric;
+const char *rowKernelName = "generic";
+//row kernel accumulating the weights of the projector for the grid of the run
+void (*weighRow)(const struct rowTrace *t, int r, double *aX, double *aY, double *aZ, double *aMerged, struct traversalStats *stats) = weighRowGeneric;
+
+/**
+ * Selects the row kernel specialised for the grid of the run and the kernel of its weights, in the selected instruction
+ * set, once the grid is known.
+ */
+void selectRowKernel( void ){
+    const int cubic = !yPlaneCoordinates && nVoxel[X] == nVoxel[Y] && nVoxel[X] == nVoxel[Z] && VOXEL_X == VOXEL_Y && VOXEL_X == VOXEL_Z;
+    const int powerOfTwo = cubic && (nVoxel[X] & (nVoxel[X] - 1)) == 0;
+
+    weighRow = yPlaneCoordinates ? weighRowRectilinearVariants[selectedIsa] : weighRowGenericVariants[selectedIsa];
+    if(yPlaneCoordinates){
+        traceRow = traceRowRectilinearVariants[selectedIsa];
+        rowKernelName = "rectilinear";
+#ifdef KERNEL_SIDE
+    } else if(cubic && nVoxel[X] == KERNEL_SIDE){
+        traceRow = traceRowFixedSideVariants[selectedIsa];
+        rowKernelName = "cubic, fixed side";
+#endif
+    } else if(powerOfTwo){
+        traceRow = traceRowCubicPowerOfTwoVariants[selectedIsa];
+        rowKernelName = "cubic, power-of-two side";
+    } else if(cubic){
+        traceRow = traceRowCubicVariants[selectedIsa];
+        rowKernelName = "cubic";
+    } else {
+        traceRow = traceRowGenericVariants[selectedIsa];
+        rowKernelName = "generic";
+    }
+}
+
+/**
+ * Sets up the data shared by the rows of a position, in the axes of the sub-sections.
+ * 'positionIndex' is the index of the angular position.
+ * 'slice' is the index of the sub-section of the object.
+ * 'f' is the array of the sub-section, 'absorbment' the array of the projections.
+ * 'frame' and 'beam' are the pointers on which to store the detector frame and the direction of the parallel beam,
+ * which 'trace' points to.
+ * 'trace' is the pointer on which to store the data of the position.
+*/
+void setupRowTrace(int positionIndex, int slice, double *f, double *absorbment, struct detectorFrame *frame, struct point *beam, struct rowTrace *trace){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    //gets the detector frame based on whether the detector rotates or not, in the axes of the sub-sections
+    *frame = view_frame[stationaryDetector ? nTheta / 2 : positionIndex];
+    swapFrameAxis(frame, slabAxis);
+    //the rays of a parallel beam are parallel to the central ray of the cone
+    double central[3];
+    getCentralRay(positionIndex, central);
+    *beam = swapPointAxis((struct point){central[X], central[Y], central[Z]}, slabAxis);
+    const struct rowTrace position = {
+        swapPointAxis(getSource(positionIndex), slabAxis),
+        frame,
+        positionIndex, slice, f, absorbment,
+        rayStates ? rayStates + (size_t)2 * positionIndex * nSidePixels * nSidePixels : NULL,
+        parallelBeam ? beam : NULL
+    };
+    *trace = position;
+}
+
+/**
+ * Computes the projection of a sub-section of the object onto the detector for each source position.
+ * 'slice' is the index of the sub-section of the object.
+ * 'view' is the only position to be traced, -1 to trace every position whose sub-sections are cut along the traced axis.
+ * 'f' is an array stores the coefficients of the voxels cointained in the sub-section.
+ * 'absorbment' is the resulting array, contains the value of absorbtion for each pixel.
+ * 'absMax' is the maximum absorbtion computed.
+ * 'absMax' is the minimum absorbtion computed.
+*/
+void computeProjections(int slice, int view, double *f, double *absorbment, double *absMax, double *absMin){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    double amax = -INFINITY;
+    double amin = INFINITY;
+    double nRays = 0, nIntersections = 0, nSegments = 0;
+    double aMerged[nPlanes[X] + nPlanes[Y] + nPlanes[Z] + 2];
+    double aX[nPlanes[X]];
+    double aY[nPlanes[Y]];
+    double aZ[nPlanes[Z]];
+
+    //iterates over each source whose sub-sections are cut along the traced axis
+    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+        if(view_slabAxis[positionIndex] != slabAxis || (view >= 0 && positionIndex != view))
+            continue;
+        struct detectorFrame frame;
+        struct point beam;
+        struct rowTrace trace;
+        setupRowTrace(positionIndex, slice, f, absorbment, &frame, &beam, &trace);
+
+        //iterates over each row of the detector
+        PROFILE_BEGIN(viewStart);
+#pragma omp parallel for schedule(dynamic) default(none) shared(nSidePixels, trace, traceRow) private(aX, aY, aZ, aMerged) reduction(min:amin) reduction(max:amax) reduction(+:nRays, nIntersections, nSegments)
+        for(int r = 0; r < nSidePixels; r++){
+            struct traversalStats stats = {INFINITY, -INFINITY, 0, 0, 0};
+            traceRow(&trace, r, aX, aY, aZ, aMerged, &stats);
+            amin = fmin(amin, stats.amin);
+            amax = fmax(amax, stats.amax);
+            nRays += stats.nRays;
+            nIntersections += stats.nIntersections;
+            nSegments += stats.nSegments;
+        }
+        PROFILE_END(STAGE_VIEW, viewStart);
+        //the view is final once the last sub-section is projected
+        if(slice + OBJ_BUFFER >= nVoxel[Y])
+            markViewReady(positionIndex);
+    }
+    *absMax = amax;
+    *absMin = amin;
+    traversalRays += nRays;
+    traversalIntersections += nIntersections;
+    traversalSegments += nSegments;
+}
+
+//normalisation of the iterative solvers (SART): the row sums (length of each ray within the object) and the column sums
+//(length of all the rays within each voxel) of the weights of the ray tracer, cached on disk for each geometry
+
+//models the header of a cached normalisation, followed by the row sums in projection order and the column sums
+//[y][z][x], as floats
+struct normalisationHeader{
+    char magic[8];              //"PROJNRM"
+    uint64_t geometryHash;      //hash of the geometry, as returned by getGeometryHash
+    int32_t width;              //number of columns of the detector
+    int32_t height;             //number of rows of the detector
+    int32_t nViews;             //number of projections
+    int32_t nVoxel[3];          //number of voxels along each axis
+};
+
+/**
+ * Hashes bytes with the 64-bit FNV-1a function.
+ * Returns the updated hash.
+ * 'hash' is the hash of the previous bytes, or the offset basis of the function.
+ * 'data' is the pointer to the bytes, 'length' their number.
+ */
+uint64_t hashBytes(uint64_t hash, const void *data, size_t length){
+    const unsigned char *bytes = (const unsigned char*)data;
+    for(size_t i = 0; i < length; i++){
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Returns the hash of the geometry determining the weights of the ray tracer: the grid, the detector, the beam and the
+ * source and detector frame of each position, in which the tilt, the misalignment and the perturbations are folded.
+ */
+uint64_t getGeometryHash( void ){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    const int sizes[12] = {nSidePixels, nVoxel[X], nVoxel[Y], nVoxel[Z], VOXEL_X, VOXEL_Y, VOXEL_Z, VOXEL_MAT,
+                           nTheta, OBJ_BUFFER, stationaryDetector, parallelBeam};
+    uint64_t hash = hashBytes(14695981039346656037ULL, sizes, sizeof(sizes));
+    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+        const struct point source = getSource(positionIndex);
+        hash = hashBytes(hash, &source, sizeof(source));
+        hash = hashBytes(hash, &view_frame[positionIndex], sizeof(view_frame[positionIndex]));
+    }
+    if(yPlaneCoordinates)
+        hash = hashBytes(hash, yPlaneCoordinates, sizeof(double) * nPlanes[Y]);
+    return hash;
+}
+
+/**
+ * Accumulates the weights of the ray tracer over a sub-section of the object cut along the y axis, for each position.
+ * 'slice' is the index of the sub-section.
+ * 'weights' is the array on which to add the column sums of the voxels of the sub-section.
+ * 'rowSums' is the array on which to add the row sums, in projection order.
+*/
+void computeWeights(int slice, double *weights, double *rowSums){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    double aMerged[nPlanes[X] + nPlanes[Y] + nPlanes[Z] + 2];
+    double aX[nPlanes[X]];
+    double aY[nPlanes[Y]];
+    double aZ[nPlanes[Z]];
+
+    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+        struct detectorFrame frame;
+        struct point beam;
+        struct rowTrace trace;
+        setupRowTrace(positionIndex, slice, weights, rowSums, &frame, &beam, &trace);
+        trace.rayState = NULL;
+#pragma omp parallel for schedule(dynamic) default(none) shared(nSidePixels, trace, weighRow) private(aX, aY, aZ, aMerged)
+        for(int r = 0; r < nSidePixels; r++){
+            struct traversalStats stats = {INFINITY, -INFINITY, 0, 0, 0};
+            weighRow(&trace, r, aX, aY, aZ, aMerged, &stats);
+        }
+    }
+}
+
+/**
+ * Writes values as floats.
+ * Returns 1 on success, 0 otherwise.
+ * 'file' is the file on which to write.
+ * 'values' is the array of the values, 'length' their number.
+ * 'buffer' is an array of at least 'length' floats.
+*/
+int writeFloats(FILE *file, const double *values, size_t length, float *buffer){
+#pragma omp parallel for schedule(static) default(none) shared(values, length, buffer)
+    for(size_t i = 0; i < length; i++){
+        buffer[i] = (float)values[i];
+    }
+    return fwrite(buffer, sizeof(float), length, file) == length;
+}
+
+/**
+ * Makes the normalisation of the iterative solvers available in a cache directory, as 'directory'/sart-<hash>.f32 where
+ * <hash> is the hash of the geometry: a complete file of the same geometry is kept, otherwise the weights are computed
+ * with one traversal of the object and written to a temporary file of its own, renamed once complete, so that runs sharing
+ * the cache never write through the same file.
+ * Returns 1 on success, 0 otherwise.
+ * 'directory' is the directory of the cache.
+ * 'slab' is an array of at least OBJ_BUFFER * nVoxel[X] * nVoxel[Z] values, used as the column sums of a sub-section.
+*/
+int cacheNormalisation(const char *directory, double *slab){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    const size_t viewLength = (size_t)nSidePixels * nSidePixels;
+    const size_t slabLength = (size_t)OBJ_BUFFER * nVoxel[X] * nVoxel[Z];
+    const size_t rowSumsOffset = sizeof(struct normalisationHeader);
+    const size_t size = rowSumsOffset + sizeof(float) * (viewLength * (nTheta + 1) + (size_t)nVoxel[X] * nVoxel[Y] * nVoxel[Z]);
+    const struct normalisationHeader header = {"PROJNRM", getGeometryHash(), nSidePixels, nSidePixels, nTheta + 1, {nVoxel[X], nVoxel[Y], nVoxel[Z]}};
+    char path[4096], partialPath[4096 + 8];
+    snprintf(path, sizeof(path), "%s/sart-%016llx.f32", directory, (unsigned long long)header.geometryHash);
+    snprintf(partialPath, sizeof(partialPath), "%s.XXXXXX", path);
+
+    FILE *file = fopen(path, "rb");
+    if(file){
+        struct normalisationHeader cached;
+        const int valid = fread(&cached, sizeof(cached), 1, file) == 1 && !memcmp(&cached, &header, sizeof(header)) &&
+                          !fseek(file, 0, SEEK_END) && ftell(file) == (long)size;
+        fclose(file);
+        if(valid){
+            fprintf(stderr,"SART normalisation: %s (cached)\n", path);
+            return 1;
+        }
+    }
+
+    double time = omp_get_wtime();
+    double *rowSums = (double*)calloc(viewLength * (nTheta + 1), sizeof(double));
+    float *buffer = (float*)malloc(sizeof(float) * (slabLength > viewLength ? slabLength : viewLength));
+#ifdef __linux__
+    //the temporary name is unique, the file is readable by the other users of the cache once renamed
+    const int fd = mkstemp(partialPath);
+    file = fd >= 0 && !fchmod(fd, 0644) ? fdopen(fd, "wb") : NULL;
+    if(fd >= 0 && !file)
+        close(fd);
+#else
+    snprintf(partialPath, sizeof(partialPath), "%s.tmp", path);
+    file = fopen(partialPath, "wb");
+#endif
+    int written = rowSums && buffer && file;
+    //the row sums are complete after the last sub-section, they are written before the column sums at the end
+    written = written && !fseek(file, rowSumsOffset + sizeof(float) * viewLength * (nTheta + 1), SEEK_SET);
+    for(int slice = 0; written && slice < nVoxel[Y]; slice += OBJ_BUFFER){
+        memset(slab, 0, sizeof(double) * slabLength);
+        computeWeights(slice, slab, rowSums);
+        written = writeFloats(file, slab, (size_t)min(OBJ_BUFFER, nVoxel[Y] - slice) * nVoxel[X] * nVoxel[Z], buffer);
+    }
+    written = written && !fseek(file, 0, SEEK_SET) && fwrite(&header, sizeof(header), 1, file) == 1;
+    for(int view = 0; written && view <= nTheta; view++){
+        written = writeFloats(file, rowSums + view * viewLength, viewLength, buffer);
+    }
+    written = file && !fclose(file) && written && !rename(partialPath, path);
+    free(rowSums);
+    free(buffer);
+    if(!written){
+        perror(path);
+        remove(partialPath);
+        return 0;
+    }
+    fprintf(stderr,"SART normalisation: %s (computed in %lf s)\n", path, omp_get_wtime() - time);
+    return 1;
+}
+
+//shear-warp projector: the slices of the object orthogonal to the axis most aligned with the rays of a position are
+//resampled onto a common plane and summed with sequential accesses, then the sum is warped onto the detector
+
+//models the intermediate image of a position: the sum of the slices resampled onto the plane of the principal axis
+//farthest from the source, in the axes of the sub-sections (the principal axis in place of y)
+struct shearWarpImage{
+    double *values;             //[row][column], rows along z and columns along x
+    int width;
+    int height;
+    double x0;                  //coordinate of the first column
+    double z0;                  //coordinate of the first row
+    double plane;               //coordinate of the plane along the principal axis
+};
+
+/**
+ * Returns the axis most aligned with the rays of a position, relative to the side of the voxels along each axis.
+ * 'positionIndex' is the index of the angular position.
+ */
+enum axis getPrincipalAxis(int positionIndex){
+    const int voxelSide[3] = {VOXEL_X, VOXEL_Y, VOXEL_Z};
+    double d[3];
+    enum axis best = Y;
+    getCentralRay(positionIndex, d);
+    for(int ax = 0; ax < 3; ax++){
+        if(fabs(d[ax]) / voxelSide[ax] > fabs(d[best]) / voxelSide[best])
+            best = ax;
+    }
+    return best;
+}
+
+/**
+ * Allocates the intermediate image of a position, covering the shadow of the object on the plane of the principal axis
+ * farthest from the source; the globals of the grid are those of the sub-sections.
+ * Returns 1 on success, 0 otherwise.
+ * 'w' is the pointer to the image.
+ * 'source' is the position of the source, in the axes of the sub-sections.
+ */
+int initShearWarpImage(struct shearWarpImage *w, struct point source){
+    const double lo[3] = {getXPlane(0), getYPlane(0), getZPlane(0)};
+    const double hi[3] = {getXPlane(nPlanes[X] - 1), getYPlane(nPlanes[Y] - 1), getZPlane(nPlanes[Z] - 1)};
+    double xMin = INFINITY, xMax = -INFINITY, zMin = INFINITY, zMax = -INFINITY;
+
+    w->plane = fabs(hi[Y] - source.y) > fabs(lo[Y] - source.y) ? hi[Y] : lo[Y];
+    for(int corner = 0; corner < 8; corner++){
+        const double x = corner & 1 ? hi[X] : lo[X];
+        const double y = corner & 2 ? hi[Y] : lo[Y];
+        const double z = corner & 4 ? hi[Z] : lo[Z];
+        const double scale = (w->plane - source.y) / (y - source.y);
+        xMin = fmin(xMin, source.x + (x - source.x) * scale);
+        xMax = fmax(xMax, source.x + (x - source.x) * scale);
+        zMin = fmin(zMin, source.z + (z - source.z) * scale);
+        zMax = fmax(zMax, source.z + (z - source.z) * scale);
+    }
+    w->x0 = xMin;
+    w->z0 = zMin;
+    w->width = (int)ceil((xMax - xMin) / VOXEL_X) + 1;
+    w->height = (int)ceil((zMax - zMin) / VOXEL_Z) + 1;
+    w->values = (double*)calloc((size_t)w->width * w->height, sizeof(double));
+    return w->values != NULL;
+}
+
+/**
+ * Computes the bilinear interpolation weights of the voxels along an axis for a set of evenly spaced coordinates;
+ * voxels outside the object get a null weight.
+ * 'first' is the first coordinate, 'step' the distance between the coordinates, 'count' their number.
+ * 'firstPlane' is the coordinate of the first plane of the axis, 'side' the side of the voxels and 'nVoxels' their number.
+ * 'index' and 'weight' are the arrays on which to store the indices and weights of the two voxels of each coordinate.
+*/
+void getInterpolationWeights(double first, double step, int count, double firstPlane, double side, int nVoxels, int *index, double *weight){
+    for(int j = 0; j < count; j++){
+        const double u = (first + j * step - firstPlane) / side - 0.5;
+        const int i0 = (int)floor(u);
+        const double t = u - i0;
+        index[2 * j] = i0 < 0 ? 0 : min(i0, nVoxels - 1);
+        index[2 * j + 1] = i0 + 1 < 0 ? 0 : min(i0 + 1, nVoxels - 1);
+        weight[2 * j] = i0 >= 0 && i0 < nVoxels ? 1 - t : 0;
+        weight[2 * j + 1] = i0 + 1 >= 0 && i0 + 1 < nVoxels ? t : 0;
+    }
+}
+
+/**
+ * Resamples the slices of a sub-section onto the intermediate image of a position and adds them to it.
+ * With a point source each slice is scaled about the source's foot, so the resampling is separable: the weights of the
+ * columns are computed once per slice and each row of the image reads two rows of the slice sequentially.
+ * 'w' is the pointer to the image.
+ * 'source' is the position of the source, in the axes of the sub-sections.
+ * 'slice' is the index of the sub-section.
+ * 'f' is the array of the coefficients of the sub-section.
+*/
+void shearWarpSlab(struct shearWarpImage *w, struct point source, int slice, const double *f){
+    const int nSlices = min(OBJ_BUFFER, nVoxel[Y] - slice);
+    const int width = w->width;
+    int *columns = (int*)malloc(sizeof(int) * 2 * width * nSlices);
+    double *columnWeights = (double*)malloc(sizeof(double) * 2 * width * nSlices);
+    double scale[nSlices];
+
+    for(int n = 0; n < nSlices; n++){
+        const double y = getYPlane(slice + n) + VOXEL_Y / 2.0;
+        //a point of the image maps to the slice by a scale about the source
+        scale[n] = (y - source.y) / (w->plane - source.y);
+        getInterpolationWeights(source.x + (w->x0 - source.x) * scale[n], VOXEL_X * scale[n], width,
+                                getXPlane(0), VOXEL_X, nVoxel[X], columns + 2 * width * n, columnWeights + 2 * width * n);
+    }
+
+#pragma omp parallel for schedule(static) default(none) shared(w, source, f, nSlices, width, columns, columnWeights, scale, nVoxel, VOXEL_Z)
+    for(int i = 0; i < w->height; i++){
+        double *image = w->values + (size_t)i * width;
+        for(int n = 0; n < nSlices; n++){
+            int rows[2];
+            double rowWeights[2];
+            getInterpolationWeights(source.z + (w->z0 + i * VOXEL_Z - source.z) * scale[n], 0, 1,
+                                    getZPlane(0), VOXEL_Z, nVoxel[Z], rows, rowWeights);
+            if(rowWeights[0] == 0 && rowWeights[1] == 0)
+                continue;
+            const double *row0 = f + ((size_t)n * nVoxel[Z] + rows[0]) * nVoxel[X];
+            const double *row1 = f + ((size_t)n * nVoxel[Z] + rows[1]) * nVoxel[X];
+            const int *c = columns + 2 * width * n;
+            const double *cw = columnWeights + 2 * width * n;
+#pragma omp simd
+            for(int j = 0; j < width; j++){
+                image[j] += rowWeights[0] * (cw[2 * j] * row0[c[2 * j]] + cw[2 * j + 1] * row0[c[2 * j + 1]])
+                          + rowWeights[1] * (cw[2 * j] * row1[c[2 * j]] + cw[2 * j + 1] * row1[c[2 * j + 1]]);
+            }
+        }
+    }
+    free(columns);
+    free(columnWeights);
+}
+
+/**
+ * Warps the intermediate image of a position onto the detector: each pixel samples the image where its ray crosses
+ * the plane of the image, weighted by the length of the ray within a slice.
+ * 'w' is the pointer to the image.
+ * 'positionIndex' is the index of the position.
+ * 'source' and 'frame' are the source and the frame of the detector, in the axes of the sub-sections.
+ * 'absorbment' is the resulting array, contains the value of absorbtion for each pixel.
+*/
+void warpShearWarpImage(const struct shearWarpImage *w, int positionIndex, struct point source, const struct detectorFrame *frame, double *absorbment){
+#pragma omp parallel for schedule(static) default(none) shared(w, positionIndex, source, frame, absorbment, nSidePixels, projectionLayout, VOXEL_X, VOXEL_Y, VOXEL_Z)
+    for(int r = 0; r < nSidePixels; r++){
+        for(int c = 0; c < nSidePixels; c++){
+            const struct point pixel = getFramePixel(frame, r, c);
+            const double d[3] = {pixel.x - source.x, pixel.y - source.y, pixel.z - source.z};
+            double value = 0;
+            if(d[Y] != 0){
+                const double t = (w->plane - source.y) / d[Y];
+                const double u = (source.x + t * d[X] - w->x0) / VOXEL_X;
+                const double v = (source.z + t * d[Z] - w->z0) / VOXEL_Z;
+                const int j = (int)floor(u);
+                const int i = (int)floor(v);
+                if(i >= 0 && j >= 0 && i + 1 < w->height && j + 1 < w->width){
+                    const double *row = w->values + (size_t)i * w->width + j;
+                    const double a = u - j;
+                    const double b = v - i;
+                    value = (1 - b) * ((1 - a) * row[0] + a * row[1]) + b * ((1 - a) * row[w->width] + a * row[w->width + 1]);
+                    value *= VOXEL_Y * sqrt(d[X] * d[X] + d[Y] * d[Y] + d[Z] * d[Z]) / fabs(d[Y]);
+                }
+            }
+            absorbment[getPixelIndex(projectionLayout, positionIndex, r, c)] = value;
+        }
+    }
+}
+
+/**
+ * Computes the projections with the shear-warp projector. The positions are grouped by principal axis; the object is
+ * generated in sub-sections cut along the principal axis of each group, and each sub-section is added to the intermediate
+ * images of the group's positions before the images are warped onto the detector.
+ * Returns 1 on success, 0 otherwise.
+ * 'objectType' is the type of the object.
+ * 'f' is an array large enough for a sub-section cut along any axis.
+ * 'absorbment' is the resulting array, contains the value of absorbtion for each pixel.
+ * 'absMax' and 'absMin' are the maximum and minimum absorbtion computed.
+*/
+int computeShearWarpProjections(int objectType, double *f, double *absorbment, double *absMax, double *absMin){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    struct shearWarpImage images[nTheta + 1];
+    enum axis principal[nTheta + 1];
+    double amax = -INFINITY;
+    double amin = INFINITY;
+
+    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+        principal[positionIndex] = getPrincipalAxis(positionIndex);
+    }
+    for(int ax = 0; ax < 3; ax++){
+        int nGroupViews = 0;
+        for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+            nGroupViews += principal[positionIndex] == (enum axis)ax;
+        }
+        if(nGroupViews == 0)
+            continue;
+
+        swapSlabAxis(ax);
+        for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+            images[positionIndex].values = NULL;
+            if(principal[positionIndex] == (enum axis)ax && !initShearWarpImage(&images[positionIndex], swapPointAxis(getSource(positionIndex), ax))){
+                fprintf(stderr,"Cannot allocate the intermediate images\n");
+                swapSlabAxis(ax);
+                return 0;
+            }
+        }
+        swapSlabAxis(ax);
+
+        for(int slice = 0; slice < nVoxel[ax]; slice += OBJ_BUFFER){
+            PROFILE_BEGIN(generationRegion);
+            const struct objectGrid grid = getObjectGrid();
+            generateSlab(&grid, f, OBJ_BUFFER, slice, objectType, ax);
+            PROFILE_END(STAGE_GENERATION, generationRegion);
+            swapSlabAxis(ax);
+            for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+                if(images[positionIndex].values){
+                    PROFILE_BEGIN(viewStart);
+                    shearWarpSlab(&images[positionIndex], swapPointAxis(getSource(positionIndex), ax), slice, f);
+                    PROFILE_END(STAGE_VIEW, viewStart);
+                }
+            }
+            swapSlabAxis(ax);
+        }
+
+        swapSlabAxis(ax);
+        for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+            if(!images[positionIndex].values)
+                continue;
+            struct detectorFrame frame = view_frame[stationaryDetector ? nTheta / 2 : positionIndex];
+            swapFrameAxis(&frame, ax);
+            warpShearWarpImage(&images[positionIndex], positionIndex, swapPointAxis(getSource(positionIndex), ax), &frame, absorbment);
+            free(images[positionIndex].values);
+            markViewReady(positionIndex);
+        }
+        swapSlabAxis(ax);
+    }
+
+    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+        for(int r = 0; r < nSidePixels; r++){
+            for(int c = 0; c < nSidePixels; c++){
+                const double value = absorbment[getPixelIndex(projectionLayout, positionIndex, r, c)];
+                amax = fmax(amax, value);
+                amin = fmin(amin, value);
+            }
+        }
+    }
+    *absMax = amax;
+    *absMin = amin;
+    return 1;
+}
+
+//Fourier projector: by the Fourier slice theorem, the Fourier transform of a parallel projection is the slice of the
+//object's 3D Fourier transform orthogonal to the beam; the object is transformed once, then each position costs a 2D
+//interpolation and an inverse 2D transform
+
+/**
+ * Returns the smallest power of two not below 'n'.
+ */
+int nextPowerOfTwo(int n){
+    int p = 1;
+    while(p < n)
+        p <<= 1;
+    return p;
+}
+
+/**
+ * Returns the twiddle factors of the Fourier transforms of 'n' values: exp(-2 pi i k / n) for k < n / 2, interleaved.
+ */
+double *getTwiddles(int n){
+    double *twiddles = (double*)malloc(sizeof(double) * n);
+    for(int k = 0; k < n / 2; k++){
+        twiddles[2 * k] = cos(2 * M_PI * k / n);
+        twiddles[2 * k + 1] = -sin(2 * M_PI * k / n);
+    }
+    return twiddles;
+}
+
+/**
+ * Computes in place the discrete Fourier transform of 'n' complex values, with the iterative radix-2 algorithm.
+ * 'data' is the array of values, real and imaginary parts interleaved.
+ * 'n' is the number of values, a power of two.
+ * 'twiddles' is the array returned by getTwiddles for 'n'.
+ * 'inverse' is 1 for the inverse transform, which is not normalised.
+*/
+void fft(double *data, int n, const double *twiddles, int inverse){
+    const double sign = inverse ? -1 : 1;
+    for(int i = 1, j = 0; i < n; i++){
+        int bit = n >> 1;
+        for(; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j){
+            const double re = data[2 * i], im = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = re;
+            data[2 * j + 1] = im;
+        }
+    }
+    for(int len = 2; len <= n; len <<= 1){
+        const int stride = n / len;
+        for(int start = 0; start < n; start += len){
+            for(int k = 0; k < len / 2; k++){
+                const double wr = twiddles[2 * k * stride];
+                const double wi = sign * twiddles[2 * k * stride + 1];
+                double *a = data + 2 * (start + k);
+                double *b = data + 2 * (start + k + len / 2);
+                const double br = b[0] * wr - b[1] * wi;
+                const double bi = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - br;
+                b[1] = a[1] - bi;
+                a[0] += br;
+                a[1] += bi;
+            }
+        }
+    }
+}
+
+/**
+ * Computes in place the Fourier transform of some lines of a grid along one of its axes, the lines in parallel.
+ * The lines are gathered FFT_LINE_BLOCK at a time, so that lines adjacent in memory share the cache lines they read.
+ * 'grid' is the array of complex values, interleaved.
+ * 'n' is the length of the lines, a power of two.
+ * 'stride' is the distance between two values of a line, in complex values.
+ * 'firsts' is the array of the indices of the first value of each line, in complex values.
+ * 'nLines' is the number of lines.
+ * 'twiddles' is the array returned by getTwiddles for 'n'.
+ * 'inverse' is 1 for the inverse transform.
+*/
+void fftLines(double *grid, int n, size_t stride, const size_t *firsts, size_t nLines, const double *twiddles, int inverse){
+#pragma omp parallel default(none) shared(grid, n, stride, firsts, nLines, twiddles, inverse)
+    {
+        double *lines = (double*)malloc(sizeof(double) * 2 * n * FFT_LINE_BLOCK);
+#pragma omp for schedule(static)
+        for(size_t block = 0; block < nLines; block += FFT_LINE_BLOCK){
+            const int nBlockLines = (int)(nLines - block < FFT_LINE_BLOCK ? nLines - block : FFT_LINE_BLOCK);
+            for(int k = 0; k < n; k++){
+                for(int l = 0; l < nBlockLines; l++){
+                    const double *value = grid + 2 * (firsts[block + l] + k * stride);
+                    lines[2 * (l * n + k)] = value[0];
+                    lines[2 * (l * n + k) + 1] = value[1];
+                }
+            }
+            for(int l = 0; l < nBlockLines; l++){
+                fft(lines + 2 * l * n, n, twiddles, inverse);
+            }
+            for(int k = 0; k < n; k++){
+                for(int l = 0; l < nBlockLines; l++){
+                    double *value = grid + 2 * (firsts[block + l] + k * stride);
+                    value[0] = lines[2 * (l * n + k)];
+                    value[1] = lines[2 * (l * n + k) + 1];
+                }
+            }
+        }
+        free(lines);
+    }
+}
+
+/**
+ * Returns sin(pi x) / (pi x).
+ */
+double sinc(double x){
+    return x == 0 ? 1 : sin(M_PI * x) / (M_PI * x);
+}
+
+/**
+ * Returns the modified Bessel function of the first kind of order 0, by its power series.
+ */
+double besselI0(double x){
+    double sum = 1, term = 1;
+    for(int k = 1; term > 1e-16 * sum; k++){
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/**
+ * Returns the Kaiser-Bessel interpolation kernel of the Fourier projector, FOURIER_KERNEL_WIDTH samples wide.
+ * 'u' is the distance from the interpolated frequency, in samples of the grid.
+ * 'beta' is the shape of the kernel.
+ */
+double kaiserBessel(double u, double beta){
+    const double t = 2 * u / FOURIER_KERNEL_WIDTH;
+    return fabs(t) < 1 ? besselI0(beta * sqrt(1 - t * t)) : 0;
+}
+
+/**
+ * Returns the Fourier transform of the Kaiser-Bessel kernel, by which the samples are divided before gridding.
+ * 'x' is the position of the sample, in fractions of the grid's side.
+ * 'beta' is the shape of the kernel.
+ */
+double kaiserBesselTransform(double x, double beta){
+    const double t2 = beta * beta - (M_PI * FOURIER_KERNEL_WIDTH * x) * (M_PI * FOURIER_KERNEL_WIDTH * x);
+    const double t = sqrt(fabs(t2));
+    if(t == 0)
+        return FOURIER_KERNEL_WIDTH;
+    return FOURIER_KERNEL_WIDTH * (t2 > 0 ? sinh(t) : sin(t)) / t;
+}
+
+/**
+ * Computes the axes of the slice of the object's Fourier transform seen by the detector of a position, for a parallel
+ * beam along the central ray: the frequency of the object seen at the frequency (nu1, nu2) of the detector, in cycles per
+ * pixel, is orthogonal to the beam and has the components nu1 and nu2 along the columns and rows, nu1 'a' + nu2 'b'.
+ * 'a' and 'b' are the first columns of the inverse of the matrix of rows colStep, rowStep and the beam; they are also
+ * the vectors giving the column and row coordinates on the detector of a point projected along the beam.
+ * Returns the determinant of the matrix, the area of a pixel seen by the beam.
+ * 'positionIndex' is the index of the angular position.
+ * 'a' and 'b' are the arrays on which to store the axes.
+ */
+double getSliceAxes(int positionIndex, double *a, double *b){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    const struct detectorFrame *frame = &view_frame[stationaryDetector ? nTheta / 2 : positionIndex];
+    const struct point col = frame->colStep, row = frame->rowStep;
+    double u[3];
+    getCentralRay(positionIndex, u);
+    const double length = sqrt(u[X] * u[X] + u[Y] * u[Y] + u[Z] * u[Z]);
+    for(int ax = 0; ax < 3; ax++){
+        u[ax] /= length;
+    }
+    const double cross[2][3] = {
+        {row.y * u[Z] - row.z * u[Y], row.z * u[X] - row.x * u[Z], row.x * u[Y] - row.y * u[X]},
+        {u[Y] * col.z - u[Z] * col.y, u[Z] * col.x - u[X] * col.z, u[X] * col.y - u[Y] * col.x}
+    };
+    const double det = col.x * cross[0][X] + col.y * cross[0][Y] + col.z * cross[0][Z];
+    for(int ax = 0; ax < 3; ax++){
+        a[ax] = cross[0][ax] / det;
+        b[ax] = cross[1][ax] / det;
+    }
+    return det;
+}
+
+/**
+ * Computes the parallel projections with the Fourier projector.
+ * The object is sampled on a grid FOURIER_OVERSAMPLING times larger than the object along each axis, centered on the grid's
+ * origin and divided by the transform of the Kaiser-Bessel interpolation kernel (gridding correction), then transformed.
+ * For each position, the slice orthogonal to the beam is interpolated on the frequencies of the detector, multiplied by
+ * the transform of a voxel so that the voxels are constant as for the ray tracer, and transformed back.
+ * The beam is parallel to the central ray of each position and the detector may be oblique to it.
+ * Returns 1 on success, 0 otherwise.
+ * 'objectType' is the type of the object.
+ * 'f' is an array of the size of a sub-section cut along y.
+ * 'absorbment' is the resulting array, contains the value of absorbtion for each pixel.
+ * 'absMax' and 'absMin' are the maximum and minimum absorbtion computed.
+*/
+int computeFourierProjections(int objectType, double *f, double *absorbment, double *absMax, double *absMin){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    const int m = nextPowerOfTwo(FOURIER_OVERSAMPLING * (int)fmax(nVoxel[X], fmax(nVoxel[Y], nVoxel[Z])));
+    //side of the detector's transform, the detector and the projection of the object fit in its period
+    int nd = nextPowerOfTwo(nSidePixels);
+    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+        const struct detectorFrame *frame = &view_frame[stationaryDetector ? nTheta / 2 : positionIndex];
+        double a[3], b[3];
+        getSliceAxes(positionIndex, a, b);
+        double lo[2] = {0, 0}, hi[2] = {nSidePixels, nSidePixels};
+        for(int corner = 0; corner < 8; corner++){
+            const double x[3] = {
+                (corner & 1 ? getXPlane(nPlanes[X] - 1) : getXPlane(0)) - frame->origin.x,
+                (corner & 2 ? getYPlane(nPlanes[Y] - 1) : getYPlane(0)) - frame->origin.y,
+                (corner & 4 ? getZPlane(nPlanes[Z] - 1) : getZPlane(0)) - frame->origin.z
+            };
+            const double s[2] = {a[X] * x[X] + a[Y] * x[Y] + a[Z] * x[Z], b[X] * x[X] + b[Y] * x[Y] + b[Z] * x[Z]};
+            for(int i = 0; i < 2; i++){
+                lo[i] = fmin(lo[i], s[i]);
+                hi[i] = fmax(hi[i], s[i]);
+            }
+        }
+        nd = (int)fmax(nd, nextPowerOfTwo((int)ceil(fmax(hi[0] - lo[0], hi[1] - lo[1]))));
+    }
+    const double side[3] = {VOXEL_X, VOXEL_Y, VOXEL_Z};
+    double reference[3];                                            //coordinates of the voxel at the origin of the grid
+    double *grid = (double*)calloc((size_t)2 * m * m * m, sizeof(double));
+    double *slice = (double*)malloc(sizeof(double) * 2 * nd * nd);
+    size_t *lines = (size_t*)malloc(sizeof(size_t) * m * m);
+    size_t *rows = (size_t*)malloc(sizeof(size_t) * nd);
+    size_t *columns = (size_t*)malloc(sizeof(size_t) * nd);
+    double *gridTwiddles = getTwiddles(m);
+    double *detectorTwiddles = getTwiddles(nd);
+    double *correction[3];
+    //shape of the kernel for an oversampling of 2 (Beatty et al.), which keeps the aliases of the samples small
+    const double halfOversampling = FOURIER_KERNEL_WIDTH * 0.75;
+    const double beta = M_PI * sqrt(halfOversampling * halfOversampling - 0.8);
+    //the kernel is tabulated over its half width and linearly interpolated
+    double kernel[FOURIER_KERNEL_TABLE + 2];
+    double amax = -INFINITY;
+    double amin = INFINITY;
+
+    if(yPlaneCoordinates || !grid || !slice || !lines || !rows || !columns){
+        fprintf(stderr, yPlaneCoordinates ? "The Fourier projector requires uniform planes\n" : "Cannot allocate the Fourier grid\n");
+        free(grid);
+        free(slice);
+        free(lines);
+        free(rows);
+        free(columns);
+        free(gridTwiddles);
+        free(detectorTwiddles);
+        return 0;
+    }
+    reference[X] = getXPlane(0) + (nVoxel[X] / 2 + 0.5) * VOXEL_X;
+    reference[Y] = getYPlane(0) + (nVoxel[Y] / 2 + 0.5) * VOXEL_Y;
+    reference[Z] = getZPlane(0) + (nVoxel[Z] / 2 + 0.5) * VOXEL_Z;
+    for(int i = 0; i <= FOURIER_KERNEL_TABLE + 1; i++){
+        kernel[i] = kaiserBessel(i * (FOURIER_KERNEL_WIDTH / 2.0) / FOURIER_KERNEL_TABLE, beta);
+    }
+    for(int ax = 0; ax < 3; ax++){
+        correction[ax] = (double*)malloc(sizeof(double) * nVoxel[ax]);
+        for(int k = 0; k < nVoxel[ax]; k++){
+            correction[ax][k] = 1 / kaiserBesselTransform((double)(k - nVoxel[ax] / 2) / m, beta);
+        }
+    }
+
+    //samples the object, each sub-section is wrapped around the origin of the grid
+    const struct objectGrid object = getObjectGrid();
+    PROFILE_BEGIN(generationRegion);
+    for(int offset = 0; offset < nVoxel[Y]; offset += OBJ_BUFFER){
+        const int nSlices = min(OBJ_BUFFER, nVoxel[Y] - offset);
+        generateSlice(&object, f, nSlices, offset, objectType);
+#pragma omp parallel for collapse(2) schedule(static) default(none) shared(f, grid, correction, nVoxel, m, offset, nSlices)
+        for(int n = 0; n < nSlices; n++){
+            for(int k = 0; k < nVoxel[Z]; k++){
+                const int y = n + offset;
+                const size_t gy = (y - nVoxel[Y] / 2 + m) % m;
+                const size_t gz = (k - nVoxel[Z] / 2 + m) % m;
+                const double *row = f + ((size_t)n * nVoxel[Z] + k) * nVoxel[X];
+                for(int x = 0; x < nVoxel[X]; x++){
+                    const size_t gx = (x - nVoxel[X] / 2 + m) % m;
+                    grid[2 * ((gz * m + gy) * m + gx)] = row[x] * correction[X][x] * correction[Y][y] * correction[Z][k];
+                }
+            }
+        }
+    }
+    PROFILE_END(STAGE_GENERATION, generationRegion);
+
+    //the grid is stored as [z][y][x]; the transforms along x and y skip the lines that are still empty
+    const double transformStart = omp_get_wtime();
+    size_t nLines = 0;
+    for(int k = 0; k < nVoxel[Z]; k++){
+        for(int y = 0; y < nVoxel[Y]; y++){
+            lines[nLines++] = ((size_t)((k - nVoxel[Z] / 2 + m) % m) * m + (y - nVoxel[Y] / 2 + m) % m) * m;
+        }
+    }
+    fftLines(grid, m, 1, lines, nLines, gridTwiddles, 0);
+    nLines = 0;
+    for(int k = 0; k < nVoxel[Z]; k++){
+        for(int x = 0; x < m; x++){
+            lines[nLines++] = (size_t)((k - nVoxel[Z] / 2 + m) % m) * m * m + x;
+        }
+    }
+    fftLines(grid, m, m, lines, nLines, gridTwiddles, 0);
+    for(nLines = 0; nLines < (size_t)m * m; nLines++){
+        lines[nLines] = nLines;
+    }
+    fftLines(grid, m, (size_t)m * m, lines, nLines, gridTwiddles, 0);
+    for(int q = 0; q < nd; q++){
+        rows[q] = (size_t)q * nd;
+        columns[q] = q;
+    }
+    const double transformTime = omp_get_wtime() - transformStart;
+    const double slicesStart = omp_get_wtime();
+
+    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+        const struct detectorFrame *frame = &view_frame[stationaryDetector ? nTheta / 2 : positionIndex];
+        double a[3], b[3];
+        const double det = getSliceAxes(positionIndex, a, b);
+        //position of the first pixel relative to the voxel at the origin of the grid
+        const double first[3] = {frame->origin.x - reference[X], frame->origin.y - reference[Y], frame->origin.z - reference[Z]};
+
+        PROFILE_BEGIN(viewStart);
+        //interpolates the slice on the frequencies of the detector
+#pragma omp parallel for schedule(static) default(none) shared(grid, slice, nd, m, a, b, first, side, kernel)
+        for(int q = 0; q < nd; q++){
+            const double nu2 = (double)(q < nd / 2 ? q : q - nd) / nd;
+            for(int p = 0; p < nd; p++){
+                const double nu1 = (double)(p < nd / 2 ? p : p - nd) / nd;
+                double nu[3];
+                int k0[3];
+                double w[3][FOURIER_KERNEL_WIDTH];
+                double voxel = side[X] * side[Y] * side[Z];
+                double phase = 0;
+                for(int ax = 0; ax < 3; ax++){
+                    nu[ax] = nu1 * a[ax] + nu2 * b[ax];
+                    const double k = nu[ax] * m * side[ax];
+                    k0[ax] = (int)ceil(k - FOURIER_KERNEL_WIDTH / 2.0);
+                    for(int tap = 0; tap < FOURIER_KERNEL_WIDTH; tap++){
+                        const double u = fabs(k - (k0[ax] + tap)) * (FOURIER_KERNEL_TABLE / (FOURIER_KERNEL_WIDTH / 2.0));
+                        const int i = min((int)u, FOURIER_KERNEL_TABLE);
+                        w[ax][tap] = kernel[i] + (u - i) * (kernel[i + 1] - kernel[i]);
+                    }
+                    voxel *= sinc(nu[ax] * side[ax]);
+                    phase += 2 * M_PI * nu[ax] * first[ax];
+                }
+                double re = 0, im = 0;
+                for(int dz = 0; dz < FOURIER_KERNEL_WIDTH; dz++){
+                    //the transform of the samples is periodic, of period a power of two
+                    const size_t gz = (k0[Z] + dz) & (m - 1);
+                    for(int dy = 0; dy < FOURIER_KERNEL_WIDTH; dy++){
+                        const size_t gy = (k0[Y] + dy) & (m - 1);
+                        const double *plane = grid + 2 * (gz * m + gy) * m;
+                        const double weight = w[Z][dz] * w[Y][dy];
+                        double lineRe = 0, lineIm = 0;
+                        for(int dx = 0; dx < FOURIER_KERNEL_WIDTH; dx++){
+                            const size_t gx = (k0[X] + dx) & (m - 1);
+                            lineRe += w[X][dx] * plane[2 * gx];
+                            lineIm += w[X][dx] * plane[2 * gx + 1];
+                        }
+                        re += weight * lineRe;
+                        im += weight * lineIm;
+                    }
+                }
+                const double c = cos(phase) * voxel, s = sin(phase) * voxel;
+                slice[2 * ((size_t)q * nd + p)] = re * c - im * s;
+                slice[2 * ((size_t)q * nd + p) + 1] = re * s + im * c;
+            }
+        }
+        fftLines(slice, nd, 1, rows, nd, detectorTwiddles, 1);
+        fftLines(slice, nd, nd, columns, nd, detectorTwiddles, 1);
+
+        //the transform is taken per pixel, the integral over the detector is scaled by the area seen by the beam
+        const double scale = 1 / ((double)nd * nd * fabs(det));
+#pragma omp parallel for schedule(static) default(none) shared(slice, absorbment, nd, scale, positionIndex, nSidePixels, projectionLayout) reduction(max:amax) reduction(min:amin)
+        for(int r = 0; r < nSidePixels; r++){
+            for(int c = 0; c < nSidePixels; c++){
+                const double value = slice[2 * ((size_t)r * nd + c)] * scale;
+                absorbment[getPixelIndex(projectionLayout, positionIndex, r, c)] = value;
+                amax = fmax(amax, value);
+                amin = fmin(amin, value);
+            }
+        }
+        PROFILE_END(STAGE_VIEW, viewStart);
+        markViewReady(positionIndex);
+    }
+
+    for(int ax = 0; ax < 3; ax++){
+        free(correction[ax]);
+    }
+    free(grid);
+    free(slice);
+    free(lines);
+    free(rows);
+    free(columns);
+    free(gridTwiddles);
+    free(detectorTwiddles);
+    if(benchmark){
+        fprintf(stderr,"Fourier grid: %d^3, detector %d^2, transform %lf s, %lf s per position\n", m, nd, transformTime, (omp_get_wtime() - slicesStart) / (nTheta + 1));
+    }
+    *absMax = amax;
+    *absMin = amin;
+    return !isnan(amax);
+}
+
+/**
+ * Reports the speed and the accuracy of a fast method against its exact reference.
+ * 'name' and 'referenceName' are the names of the fast method and of the reference.
+ * 'projections' and 'reference' are the results of the fast method and of the reference.
+ * 'length' is the number of values of the results.
+ * 'time' and 'referenceTime' are the time spent by each method, generation included.
+*/
+void reportApproximationError(const char *name, const char *referenceName, const double *projections, const double *reference, size_t length,
+                              double time, double referenceTime){
+    double error = 0, norm = 0, maxError = 0, peak = 0;
+#pragma omp parallel for schedule(static) default(none) shared(projections, reference, length) reduction(+:error, norm) reduction(max:maxError, peak)
+    for(size_t i = 0; i < length; i++){
+        const double e = projections[i] - reference[i];
+        error += e * e;
+        norm += reference[i] * reference[i];
+        maxError = fmax(maxError, fabs(e));
+        peak = fmax(peak, fabs(reference[i]));
+    }
+    fprintf(stderr,"%s: %lf s, %s: %lf s (%.2lfx), relative RMS error %.3lf%%, maximum error %.3lf%% of the peak\n",
+            name, time, referenceName, referenceTime, referenceTime / time, 100 * sqrt(error / norm), 100 * maxError / peak);
+}
+
+//objects of a multi-object scene, each with its own grid, and the bounding volume hierarchy over their bounds
+
+//models an object of a scene: a cubic grid of voxels with its own size and position
+struct sceneObject{
+    int objectType;             //type of the generated object, as given on the command line
+    int side;                   //number of voxels per side of the grid
+    struct point center;        //position of the center of the grid
+    double rotation[3][3];      //rotation of the grid's axes into the scene's
+    int rotated;                //1 if the grid is not aligned with the scene's axes
+    double lo[3];               //smallest coordinates of the grid's bounding box, in the scene
+    double hi[3];               //largest coordinates of the grid's bounding box, in the scene
+    double gridLo[3];           //smallest coordinates of the grid, in the frame in which its rays are traced
+    double gridHi[3];           //largest coordinates of the grid, in the frame in which its rays are traced
+    double *f;                  //coefficients of the voxels, stored as [y][z][x]
+};
+
+//models a node of the bounding volume hierarchy, a leaf (count > 0) holds the objects sceneOrder[first, first + count)
+struct bvhNode{
+    double lo[3];
+    double hi[3];
+    int left;
+    int right;
+    int first;
+    int count;
+};
+
+struct sceneObject sceneObjects[MAX_SCENE_OBJECTS];
+int nSceneObjects = 0;
+
+//objects sorted so that the objects of each leaf are contiguous
+int sceneOrder[MAX_SCENE_OBJECTS];
+
+//nodes of the hierarchy, the root is the first one
+struct bvhNode sceneNodes[2 * MAX_SCENE_OBJECTS];
+int nSceneNodes = 0;
+
+/**
+ * Reads the objects of a scene from a text file.
+ * Each line contains the object type, the number of voxels per side of its grid, the position (x y z) of its center and
+ * optionally the rotation of its grid around the x, y and z axes (degrees, applied in this order);
+ * lines starting with '#' and empty lines are ignored.
+ * Returns 1 on success, 0 if a line is invalid or the scene has more than MAX_SCENE_OBJECTS objects.
+ * 'path' is the path of the file.
+*/
+int readScene(const char *path){
+    char line[256];
+    FILE *file = fopen(path, "r");
+    if(!file){
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 0;
+    }
+    nSceneObjects = 0;
+    for(int lineIndex = 1; fgets(line, sizeof(line), file); lineIndex++){
+        struct sceneObject object;
+        int length = 0;
+        sscanf(line, " %n", &length);
+        if(line[0] == '#' || line[length] == '\0')
+            continue;
+        //a line holds the five values, optionally followed by the three angles, and nothing else
+        double angles[3] = {0, 0, 0};
+        int valid = sscanf(line, "%d %d %lf %lf %lf %n", &object.objectType, &object.side,
+                           &object.center.x, &object.center.y, &object.center.z, &length) == 5;
+        if(valid && line[length] != '\0'){
+            int angleLength = 0;
+            valid = sscanf(line + length, "%lf %lf %lf %n", &angles[X], &angles[Y], &angles[Z], &angleLength) == 3;
+            length += angleLength;
+        }
+        valid = valid && line[length] == '\0';
+        if(!valid || object.side <= 0 || nSceneObjects == MAX_SCENE_OBJECTS){
+            if(valid && object.side > 0)
+                fprintf(stderr, "More than %d objects at line %d of %s: %s", MAX_SCENE_OBJECTS, lineIndex, path, line);
+            else
+                fprintf(stderr, "Invalid object at line %d of %s: %s", lineIndex, path, line);
+            nSceneObjects = 0;
+            fclose(file);
+            return 0;
+        }
+        object.rotated = angles[X] != 0 || angles[Y] != 0 || angles[Z] != 0;
+        for(int ax = 0; ax < 3; ax++){
+            angles[ax] *= M_PI / 180;
+        }
+        getRotationMatrix(angles, object.rotation);
+        object.f = NULL;
+        sceneObjects[nSceneObjects++] = object;
+    }
+    fclose(file);
+    if(nSceneObjects == 0){
+        fprintf(stderr, "No object in %s\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Computes the bounds of an object of the scene and generates its voxels.
+ * The object is generated on its own uniform grid, the global grid is left unchanged. The rays of an unrotated object
+ * are traced in the scene's frame, the ones of a rotated object in the frame of its grid, centered on the origin.
+ * Returns 1 on success, 0 if the grid cannot be allocated.
+ * 'o' is the pointer to the object.
+*/
+int generateSceneObject(struct sceneObject *o){
+    const double voxelSide[3] = {VOXEL_X, VOXEL_Y, VOXEL_Z};
+    const double center[3] = {o->center.x, o->center.y, o->center.z};
+    const struct objectGrid grid = {o->side * VOXEL_X, {o->side * voxelSide[X] / 2, o->side * voxelSide[Y] / 2, o->side * voxelSide[Z] / 2},
+                                    {o->side, o->side, o->side}, NULL};
+
+    for(int ax = 0; ax < 3; ax++){
+        //the bounding box of a rotated grid holds the rotated half sides
+        double extent = 0;
+        for(int k = 0; k < 3; k++){
+            extent += fabs(o->rotation[ax][k]) * grid.halfSide[k];
+        }
+        o->lo[ax] = center[ax] - (o->rotated ? extent : grid.halfSide[ax]);
+        o->hi[ax] = center[ax] + (o->rotated ? extent : grid.halfSide[ax]);
+        o->gridLo[ax] = o->rotated ? -grid.halfSide[ax] : o->lo[ax];
+        o->gridHi[ax] = o->rotated ? grid.halfSide[ax] : o->hi[ax];
+    }
+
+    o->f = (double*)malloc(sizeof(double) * o->side * o->side * o->side);
+    if(!o->f)
+        return 0;
+    generateSlice(&grid, o->f, o->side, 0, o->objectType);
+    return 1;
+}
+
+/**
+ * Frees the grids of the objects of the scene.
+ */
+void freeScene( void ){
+    for(int k = 0; k < nSceneObjects; k++){
+        free(sceneObjects[k].f);
+        sceneObjects[k].f = NULL;
+    }
+}
+
+/**
+ * Builds the node of the hierarchy containing the objects sceneOrder[first, first + count), splitting them recursively
+ * at the median of their centers along the longest side of their bounds.
+ * Returns the index of the node.
+*/
+int buildSceneNode(int first, int count){
+    const int index = nSceneNodes++;
+    struct bvhNode *node = &sceneNodes[index];
+
+    for(int ax = 0; ax < 3; ax++){
+        node->lo[ax] = INFINITY;
+        node->hi[ax] = -INFINITY;
+        for(int k = first; k < first + count; k++){
+            node->lo[ax] = fmin(node->lo[ax], sceneObjects[sceneOrder[k]].lo[ax]);
+            node->hi[ax] = fmax(node->hi[ax], sceneObjects[sceneOrder[k]].hi[ax]);
+        }
+    }
+    node->first = first;
+    node->count = count;
+    node->left = node->right = -1;
+    if(count <= BVH_LEAF_OBJECTS)
+        return index;
+
+    int axis = X;
+    for(int ax = Y; ax <= Z; ax++){
+        if(node->hi[ax] - node->lo[ax] > node->hi[axis] - node->lo[axis])
+            axis = ax;
+    }
+    //sorts the objects by the position of their centers along the axis
+    for(int k = first + 1; k < first + count; k++){
+        const int object = sceneOrder[k];
+        const double key = sceneObjects[object].lo[axis] + sceneObjects[object].hi[axis];
+        int j = k;
+        while(j > first && sceneObjects[sceneOrder[j - 1]].lo[axis] + sceneObjects[sceneOrder[j - 1]].hi[axis] > key){
+            sceneOrder[j] = sceneOrder[j - 1];
+            j--;
+        }
+        sceneOrder[j] = object;
+    }
+    node->count = 0;
+    node->left = buildSceneNode(first, count / 2);
+    node->right = buildSceneNode(first + count / 2, count - count / 2);
+    return index;
+}
+
+/**
+ * Builds the bounding volume hierarchy over the bounds of the objects of the scene.
+ */
+void buildSceneHierarchy( void ){
+    for(int k = 0; k < nSceneObjects; k++){
+        sceneOrder[k] = k;
+    }
+    nSceneNodes = 0;
+    buildSceneNode(0, nSceneObjects);
+}
+
+/**
+ * Clips the ray 's' + a 'd', a in [0, 1], against an axis aligned box.
+ * Returns 1 if the ray crosses the box, 0 otherwise.
+ * 's' and 'd' are the source and the direction of the ray.
+ * 'lo' and 'hi' are the smallest and largest coordinates of the box.
+ * 'aMin' and 'aMax' are the pointers on which to store the parametric values of the entry and exit points.
+*/
+int clipRayToBox(const double *s, const double *d, const double *lo, const double *hi, double *aMin, double *aMax){
+    double a0 = 0;
+    double a1 = 1;
+    for(int ax = 0; ax < 3; ax++){
+        if(d[ax] != 0){
+            const double t0 = (lo[ax] - s[ax]) / d[ax];
+            const double t1 = (hi[ax] - s[ax]) / d[ax];
+            a0 = fmax(a0, fmin(t0, t1));
+            a1 = fmin(a1, fmax(t0, t1));
+        } else if(s[ax] < lo[ax] || s[ax] > hi[ax]){
+            return 0;
+        }
+    }
+    *aMin = a0;
+    *aMax = a1;
+    return a0 < a1;
+}
+
+/**
+ * Computes the absorption of the radiological path of a ray through the grid of an object of the scene.
+ * 's' and 'd' are the source and the direction of the ray, in the frame in which the object's rays are traced.
+ * 'aMin' and 'aMax' are the parametric values of the entry and exit points of the ray into the object's grid.
+ * 'scratch' is an array of at least 6 (side + 1) + 2 elements.
+ * 'nSegments' is the pointer to the counter of the traversed segments.
+*/
+double traceSceneObject(const struct sceneObject *o, const double *s, const double *d, double aMin, double aMax, double *scratch, double *nSegments){
+    const double voxelSide[3] = {VOXEL_X, VOXEL_Y, VOXEL_Z};
+    const int nObjectPlanes = o->side + 1;
+    double *aAxis[3] = {scratch, scratch + nObjectPlanes, scratch + 2 * nObjectPlanes};
+    double *aMerged = scratch + 3 * nObjectPlanes;
+    double plane[nObjectPlanes];
+    int len[3] = {0, 0, 0};
+
+    //computes the intersections with the planes of the grid crossed between the entry and exit points
+    for(int ax = 0; ax < 3; ax++){
+        if(d[ax] != 0){
+            const double entry = s[ax] + aMin * d[ax];
+            const double exit = s[ax] + aMax * d[ax];
+            const int first = (int)fmax(0, ceil((fmin(entry, exit) - o->gridLo[ax]) / voxelSide[ax]));
+            const int last = min((int)floor((fmax(entry, exit) - o->gridLo[ax]) / voxelSide[ax]), o->side);
+            for(int k = first; k <= last; k++){
+                //the planes are listed in the order in which the ray crosses them
+                plane[len[ax]++] = o->gridLo[ax] + (d[ax] > 0 ? k : last + first - k) * voxelSide[ax];
+            }
+            getIntersection(s[ax], s[ax] + d[ax], plane, len[ax], aAxis[ax]);
+        }
+    }
+    //the entry and exit points bound the merged intersections
+    aMerged[0] = aMin;
+    const int lenA = merge3(aAxis[X], aAxis[Y], aAxis[Z], len[X], len[Y], len[Z], aMerged + 1) + 2;
+    aMerged[lenA - 1] = aMax;
+    *nSegments += lenA - 1;
+
+    const double d12 = sqrt(d[X] * d[X] + d[Y] * d[Y] + d[Z] * d[Z]);
+    double absorbment = 0.0;
+    for(int i = 0; i < lenA - 1; i++){
+        const double segments = d12 * (aMerged[i + 1] - aMerged[i]);
+        const double aMid = (aMerged[i + 1] + aMerged[i]) / 2;
+        int voxel[3];
+        for(int ax = 0; ax < 3; ax++){
+            const int v = (int)((s[ax] + aMid * d[ax] - o->gridLo[ax]) / voxelSide[ax]);
+            voxel[ax] = v < 0 ? 0 : min(v, o->side - 1);
+        }
+        absorbment += o->f[((size_t)voxel[Y] * o->side + voxel[Z]) * o->side + voxel[X]] * segments;
+    }
+    return absorbment;
+}
+
+/**
+ * Computes the absorption of the radiological path of a ray through the scene: the hierarchy is traversed and only the
+ * objects whose bounds are crossed by the ray are traced, the absorptions of overlapping objects add up.
+ * 's' and 'd' are the source and the direction of the ray.
+ * 'scratch' is an array of at least 6 (side + 1) + 2 elements, for the largest side of the objects.
+ * 'nIntersections' and 'nSegments' are the pointers to the counters of the ray-box intersections and traversed segments.
+*/
+double traceScene(const double *s, const double *d, double *scratch, double *nIntersections, double *nSegments){
+    int stack[2 * MAX_SCENE_OBJECTS];
+    int top = 0;
+    double absorbment = 0.0;
+    double aMin, aMax;
+
+    stack[top++] = 0;
+    while(top > 0){
+        const struct bvhNode *node = &sceneNodes[stack[--top]];
+        (*nIntersections)++;
+        if(!clipRayToBox(s, d, node->lo, node->hi, &aMin, &aMax))
+            continue;
+        if(node->count == 0){
+            stack[top++] = node->left;
+            stack[top++] = node->right;
+            continue;
+        }
+        for(int k = node->first; k < node->first + node->count; k++){
+            const struct sceneObject *o = &sceneObjects[sceneOrder[k]];
+            const double *objectS = s;
+            const double *objectD = d;
+            double localS[3], localD[3];
+            if(o->rotated){
+                //the ray is moved into the frame of the grid, a rigid motion leaves its parametric values unchanged
+                const double offset[3] = {s[X] - o->center.x, s[Y] - o->center.y, s[Z] - o->center.z};
+                for(int ax = 0; ax < 3; ax++){
+                    localS[ax] = o->rotation[X][ax] * offset[X] + o->rotation[Y][ax] * offset[Y] + o->rotation[Z][ax] * offset[Z];
+                    localD[ax] = o->rotation[X][ax] * d[X] + o->rotation[Y][ax] * d[Y] + o->rotation[Z][ax] * d[Z];
+                }
+                objectS = localS;
+                objectD = localD;
+            }
+            (*nIntersections)++;
+            if(clipRayToBox(objectS, objectD, o->gridLo, o->gridHi, &aMin, &aMax)){
+                absorbment += traceSceneObject(o, objectS, objectD, aMin, aMax, scratch, nSegments);
+            }
+        }
+    }
+    return absorbment;
+}
+
+/**
+ * Computes the projections of the scene onto the detector for each source position, in a single pass.
+ * 'absorbment' is the resulting array, contains the value of absorbtion for each pixel.
+ * 'absMax' is the maximum absorbtion computed.
+ * 'absMin' is the minimum absorbtion computed.
+*/
+void computeSceneProjections(double *absorbment, double *absMax, double *absMin){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    double amax = -INFINITY;
+    double amin = INFINITY;
+    double nRays = 0, nIntersections = 0, nSegments = 0;
+    int largestSide = 0;
+    for(int k = 0; k < nSceneObjects; k++){
+        largestSide = sceneObjects[k].side > largestSide ? sceneObjects[k].side : largestSide;
+    }
+    const int scratchLength = 6 * (largestSide + 1) + 2;
+
+    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+        const struct point source = getSource(positionIndex);
+        const struct detectorFrame *frame = &view_frame[stationaryDetector ? nTheta / 2 : positionIndex];
+
+        PROFILE_BEGIN(viewStart);
+#pragma omp parallel for schedule(dynamic) default(none) shared(nSidePixels, positionIndex, source, frame, absorbment, projectionLayout, scratchLength) reduction(min:amin) reduction(max:amax) reduction(+:nRays, nIntersections, nSegments)
+        for(int r = 0; r < nSidePixels; r++){
+            double scratch[scratchLength];
+            const double s[3] = {source.x, source.y, source.z};
+            for(int c = 0; c < nSidePixels; c++){
+                const struct point pixel = getFramePixel(frame, r, c);
+                const double d[3] = {pixel.x - source.x, pixel.y - source.y, pixel.z - source.z};
+                const size_t pixelIndex = getPixelIndex(projectionLayout, positionIndex, r, c);
+                const double tracedSegments = nSegments;
+                absorbment[pixelIndex] = traceScene(s, d, scratch, &nIntersections, &nSegments);
+                //as for the single object, only the rays crossing an object bound the range of absorption
+                if(nSegments > tracedSegments){
+                    amax = fmax(amax, absorbment[pixelIndex]);
+                    amin = fmin(amin, absorbment[pixelIndex]);
+                    nRays++;
+                }
+            }
+        }
+        PROFILE_END(STAGE_VIEW, viewStart);
+        markViewReady(positionIndex);
+    }
+    *absMax = amax;
+    *absMin = amin;
+    traversalRays += nRays;
+    traversalIntersections += nIntersections;
+    traversalSegments += nSegments;
+}
+
+/**
+ * Returns the dot product between 'a' and 'b'.
+ */
+double dot(struct point a, struct point b){
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+/**
+ * Returns the difference 'a' - 'b'.
+ */
+struct point sub(struct point a, struct point b){
+    struct point d = {a.x - b.x, a.y - b.y, a.z - b.z};
+    return d;
+}
+
+/**
+ * Returns the cross product between 'a' and 'b'.
+ */
+struct point cross(struct point a, struct point b){
+    struct point p = {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    return p;
+}
+
+/**
+ * Computes the homography mapping a point (x, z) of the plane y = 'depth' onto the detector's (column, row)
+ * coordinates, as seen from the index-th source position.
+ * The detector coordinates are obtained as (h[0]·p / h[2]·p, h[1]·p / h[2]·p) with p = (x, z, 1).
+ * 'index' is the index of the source position.
+ * 'detectorIndex' is the index of the detector position.
+ * 'depth' is the y coordinate of the plane.
+ * 'h' is the 3x3 array on which to store the homography.
+*/
+void getPlaneHomography(int index, int detectorIndex, double depth, double h[3][3]){
+    const struct point source = getSource(index);
+    const struct point origin = getPixel(0, 0, detectorIndex);
+    const struct point u = sub(getPixel(0, 1, detectorIndex), origin);
+    const struct point v = sub(getPixel(1, 0, detectorIndex), origin);
+    const struct point normal = cross(u, v);
+
+    //inverse of the Gram matrix of the detector's axes
+    const double uu = dot(u, u), uv = dot(u, v), vv = dot(v, v);
+    const double det = uu * vv - uv * uv;
+    const double gram[2][2] = {{vv / det, -uv / det}, {-uv / det, uu / det}};
+
+    //for a point p on the ray, (q - origin)·u * normal·(p - source) is linear in p, same for v
+    const double b = dot(normal, sub(origin, source));
+    const double au = dot(u, sub(source, origin));
+    const double av = dot(v, sub(source, origin));
+    struct point g[3];
+    const struct point gu = {au * normal.x + b * u.x, au * normal.y + b * u.y, au * normal.z + b * u.z};
+    const struct point gv = {av * normal.x + b * v.x, av * normal.y + b * v.y, av * normal.z + b * v.z};
+    for(int i = 0; i < 2; i++){
+        g[i].x = gram[i][0] * gu.x + gram[i][1] * gv.x;
+        g[i].y = gram[i][0] * gu.y + gram[i][1] * gv.y;
+        g[i].z = gram[i][0] * gu.z + gram[i][1] * gv.z;
+    }
+    g[2] = normal;
+
+    for(int i = 0; i < 3; i++){
+        h[i][0] = g[i].x;
+        h[i][1] = g[i].z;
+        h[i][2] = g[i].y * depth - dot(g[i], source);
+    }
+}
+
+/**
+ * Filters each row of each projection with a truncated ramp (Ram-Lak) kernel along the detector's columns.
+ * 'absorbment' is the array containing the projections.
+ * 'filtered' is the array on which to store the filtered projections.
+ * 'nViews' is the number of projections.
+*/
+void rampFilterProjections(double *absorbment, double *filtered, int nViews){
+    double kernel[TOMO_FILTER_WIDTH + 1];
+    kernel[0] = 0.25;
+    for(int m = 1; m <= TOMO_FILTER_WIDTH; m++){
+        kernel[m] = m % 2 ? -1 / (M_PI * M_PI * m * m) : 0;
+    }
+
+#pragma omp parallel for collapse(2) default(none) shared(absorbment, filtered, nViews, nSidePixels, kernel)
+    for(int view = 0; view < nViews; view++){
+        for(int r = 0; r < nSidePixels; r++){
+            const double *row = absorbment + ((size_t)view * nSidePixels + r) * nSidePixels;
+            double *out = filtered + ((size_t)view * nSidePixels + r) * nSidePixels;
+            for(int c = 0; c < nSidePixels; c++){
+                double sum = kernel[0] * row[c];
+                for(int m = 1; m <= TOMO_FILTER_WIDTH; m += 2){
+                    const double left = c - m >= 0 ? row[c - m] : 0;
+                    const double right = c + m < nSidePixels ? row[c + m] : 0;
+                    sum += kernel[m] * (left + right);
+                }
+                out[c] = sum;
+            }
+        }
+    }
+}
+
+/**
+ * Reconstructs planes parallel to the XZ plane by shift-and-add of the projections.
+ * Each projection is warped onto the plane through the plane-to-detector homography and the results are averaged.
+ * 'absorbment' is the array containing the (possibly filtered) projections.
+ * 'depths' is the array containing the y coordinate of each plane.
+ * 'nSlices' is the number of planes.
+ * 'slices' is the array on which to store the planes, each plane has nVoxel[Z] rows and nVoxel[X] columns.
+*/
+void reconstructTomosynthesis(double *absorbment, double *depths, int nSlices, double *slices){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+
+#pragma omp parallel for collapse(2) schedule(dynamic) default(none) shared(absorbment, depths, nSlices, slices, nVoxel, nSidePixels, stationaryDetector, nTheta, VOXEL_X, VOXEL_Z)
+    for(int s = 0; s < nSlices; s++){
+        for(int i = 0; i < nVoxel[Z]; i++){
+            double *row = slices + ((size_t)s * nVoxel[Z] + i) * nVoxel[X];
+            int count[nVoxel[X]];
+            double colCoord[nVoxel[X]], rowCoord[nVoxel[X]];
+            const double z = getZPlane(i) + VOXEL_Z / 2.0;
+
+            for(int j = 0; j < nVoxel[X]; j++){
+                row[j] = 0;
+                count[j] = 0;
+            }
+
+            for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+                double h[3][3];
+                const double *view = absorbment + (size_t)positionIndex * nSidePixels * nSidePixels;
+                getPlaneHomography(positionIndex, stationaryDetector ? nTheta / 2 : positionIndex, depths[s], h);
+
+                //maps the whole row of the plane onto the detector
+                const double x0 = getXPlane(0) + VOXEL_X / 2.0;
+#pragma omp simd
+                for(int j = 0; j < nVoxel[X]; j++){
+                    const double x = x0 + j * VOXEL_X;
+                    const double w = h[2][0] * x + h[2][1] * z + h[2][2];
+                    colCoord[j] = (h[0][0] * x + h[0][1] * z + h[0][2]) / w;
+                    rowCoord[j] = (h[1][0] * x + h[1][1] * z + h[1][2]) / w;
+                }
+
+                //bilinear interpolation of the projection
+                for(int j = 0; j < nVoxel[X]; j++){
+                    const int c = (int)floor(colCoord[j]);
+                    const int r = (int)floor(rowCoord[j]);
+                    if(c >= 0 && r >= 0 && c < nSidePixels - 1 && r < nSidePixels - 1){
+                        const double dc = colCoord[j] - c;
+                        const double dr = rowCoord[j] - r;
+                        const double *p = view + r * nSidePixels + c;
+                        row[j] += (1 - dr) * ((1 - dc) * p[0] + dc * p[1]) + dr * ((1 - dc) * p[nSidePixels] + dc * p[nSidePixels + 1]);
+                        count[j]++;
+                    }
+                }
+            }
+
+            for(int j = 0; j < nVoxel[X]; j++){
+                if(count[j] > 0)
+                    row[j] /= count[j];
+            }
+        }
+    }
+}
+
+//hierarchical backprojection: the planes are split recursively into boxes, and the projections of neighbouring positions
+//are summed on the detector of one of them over the footprint of each box, as long as the error of the transfer between
+//the two detectors is below a tolerance; the smaller the box, the more positions can be summed, so that the leaves
+//backproject a few aggregated projections instead of every position
+
+//models a projection of the hierarchical backprojection, an aggregate of the projections of several positions
+//summed on the detector of a reference position, over a window of that detector
+struct aggregateView{
+    double (*homographies)[3][3]; //plane-to-detector homography of the reference position for each plane
+    int c0, r0;                 //first column and row of the window, which may lie outside the detector
+    int width, height;          //size of the window
+    int stride;                 //distance between two rows of the arrays
+    const double *value;        //sum of the projections at each pixel of the window
+    const double *count;        //number of projections summed at each pixel, NULL when 1 everywhere
+    double *owned;              //arrays allocated for an aggregate, NULL for a window of a projection
+};
+
+//models a box of the reconstructed planes, [first, last) along the planes, the rows (z) and the columns (x)
+struct planeBox{
+    int first[3];
+    int last[3];
+};
+
+/**
+ * Maps a point of a plane onto the detector through the plane-to-detector homography 'h' of getPlaneHomography.
+ * 'x' and 'z' are the coordinates of the point.
+ * 'c' and 'r' are the pointers on which to store the column and row coordinates on the detector.
+ */
+KERNEL_INLINE void applyHomography(double h[3][3], double x, double z, double *c, double *r){
+    const double w = h[2][0] * x + h[2][1] * z + h[2][2];
+    *c = (h[0][0] * x + h[0][1] * z + h[0][2]) / w;
+    *r = (h[1][0] * x + h[1][1] * z + h[1][2]) / w;
+}
+
+/**
+ * Samples an aggregated projection by bilinear interpolation, as the shift-and-add reconstruction.
+ * Returns 1 if the point falls inside the window, 0 otherwise.
+ * 'v' is the pointer to the aggregated projection.
+ * 'c' and 'r' are the column and row coordinates on the detector.
+ * 'value' and 'count' are the pointers on which to add the interpolated sum and number of projections.
+ */
+KERNEL_INLINE int sampleAggregate(const struct aggregateView *v, double c, double r, double *value, double *count){
+    const int i = (int)floor(c - v->c0);
+    const int j = (int)floor(r - v->r0);
+    if(i < 0 || j < 0 || i >= v->width - 1 || j >= v->height - 1)
+        return 0;
+    const double dc = c - v->c0 - i;
+    const double dr = r - v->r0 - j;
+    const double *p = v->value + (size_t)j * v->stride + i;
+    *value += (1 - dr) * ((1 - dc) * p[0] + dc * p[1]) + dr * ((1 - dc) * p[v->stride] + dc * p[v->stride + 1]);
+    if(v->count){
+        const double *n = v->count + (size_t)j * v->stride + i;
+        *count += (1 - dr) * ((1 - dc) * n[0] + dc * n[1]) + dr * ((1 - dc) * n[v->stride] + dc * n[v->stride + 1]);
+    } else {
+        *count += 1;
+    }
+    return 1;
+}
+
+/**
+ * Computes the coordinates of a corner of a box of the planes.
+ * 'box' is the pointer to the box.
+ * 'corner' is the index of the corner, its bits select the last plane, row and column.
+ * 'x' and 'z' are the pointers on which to store the coordinates of the corner's voxel center; returns its plane.
+ */
+int getBoxCorner(const struct planeBox *box, int corner, double *x, double *z){
+    *x = getXPlane(0) + VOXEL_X / 2.0 + (corner & 1 ? box->last[2] - 1 : box->first[2]) * VOXEL_X;
+    *z = getZPlane(corner & 2 ? box->last[1] - 1 : box->first[1]) + VOXEL_Z / 2.0;
+    return corner & 4 ? box->last[0] - 1 : box->first[0];
+}
+
+/**
+ * Computes the window of a detector covering the projection of a box of the planes, with a margin for the interpolation.
+ * 'v' is the pointer to the aggregated projection whose detector is covered.
+ * 'box' is the pointer to the box.
+ * 'window' is the array on which to store the first column, first row, last column and last row (excluded).
+ */
+void getBoxFootprint(const struct aggregateView *v, const struct planeBox *box, int window[4]){
+    double lo[2] = {INFINITY, INFINITY}, hi[2] = {-INFINITY, -INFINITY};
+    for(int corner = 0; corner < 8; corner++){
+        double x, z, p[2];
+        const int plane = getBoxCorner(box, corner, &x, &z);
+        applyHomography(v->homographies[plane], x, z, &p[0], &p[1]);
+        for(int i = 0; i < 2; i++){
+            lo[i] = fmin(lo[i], p[i]);
+            hi[i] = fmax(hi[i], p[i]);
+        }
+    }
+    //a box is convex and so is its projection, the hull of the projections of its corners
+    window[0] = (int)floor(lo[0]) - AGGREGATE_MARGIN;
+    window[1] = (int)floor(lo[1]) - AGGREGATE_MARGIN;
+    window[2] = (int)ceil(hi[0]) + AGGREGATE_MARGIN + 1;
+    window[3] = (int)ceil(hi[1]) + AGGREGATE_MARGIN + 1;
+}
+
+/**
+ * Restricts an aggregated projection to a window, without copy.
+ * Returns 0 if the restricted projection is empty, 1 otherwise.
+ * 'v' is the pointer to the aggregated projection.
+ * 'window' is the window as returned by getBoxFootprint.
+ * 'cropped' is the pointer on which to store the restricted projection, which does not own its arrays.
+ */
+int cropAggregate(const struct aggregateView *v, const int window[4], struct aggregateView *cropped){
+    const int c0 = window[0] > v->c0 ? window[0] : v->c0;
+    const int r0 = window[1] > v->r0 ? window[1] : v->r0;
+    const int c1 = min(window[2], v->c0 + v->width);
+    const int r1 = min(window[3], v->r0 + v->height);
+    if(c1 - c0 < 2 || r1 - r0 < 2)
+        return 0;
+    *cropped = *v;
+    cropped->c0 = c0;
+    cropped->r0 = r0;
+    cropped->width = c1 - c0;
+    cropped->height = r1 - r0;
+    cropped->value = v->value + (size_t)(r0 - v->r0) * v->stride + (c0 - v->c0);
+    cropped->count = v->count ? v->count + (size_t)(r0 - v->r0) * v->stride + (c0 - v->c0) : NULL;
+    cropped->owned = NULL;
+    return 1;
+}
+
+/**
+ * Computes the homography transferring the detector of a position onto the detector of another one through a plane:
+ * exact for the points of that plane, approximate for the points of the other planes.
+ * 'a' and 'b' are the pointers to the aggregated projections of the two positions.
+ * 'plane' is the index of the plane.
+ * 't' is the 3x3 array on which to store the homography, in the form of getPlaneHomography.
+ */
+void getTransferHomography(const struct aggregateView *a, const struct aggregateView *b, int plane, double t[3][3]){
+    double (*ha)[3] = a->homographies[plane];
+    double (*hb)[3] = b->homographies[plane];
+    double inverse[3][3];
+    //the inverse is the adjugate, the scale of a homography is irrelevant
+    for(int i = 0; i < 3; i++){
+        for(int j = 0; j < 3; j++){
+            inverse[j][i] = ha[(i + 1) % 3][(j + 1) % 3] * ha[(i + 2) % 3][(j + 2) % 3] - ha[(i + 1) % 3][(j + 2) % 3] * ha[(i + 2) % 3][(j + 1) % 3];
+        }
+    }
+    for(int i = 0; i < 3; i++){
+        for(int j = 0; j < 3; j++){
+            t[i][j] = hb[i][0] * inverse[0][j] + hb[i][1] * inverse[1][j] + hb[i][2] * inverse[2][j];
+        }
+    }
+}
+
+/**
+ * Returns the largest distance, in pixels, between the exact projections of the corners of a box on the detector of 'b'
+ * and their projections on the detector of 'a' transferred by 't'.
+ * 'a' and 'b' are the pointers to the aggregated projections.
+ * 't' is the homography returned by getTransferHomography.
+ * 'box' is the pointer to the box.
+ */
+double getTransferError(const struct aggregateView *a, const struct aggregateView *b, double t[3][3], const struct planeBox *box){
+    double error = 0;
+    for(int corner = 0; corner < 8; corner++){
+        double x, z, pa[2], pb[2], pt[2];
+        const int plane = getBoxCorner(box, corner, &x, &z);
+        applyHomography(a->homographies[plane], x, z, &pa[0], &pa[1]);
+        applyHomography(b->homographies[plane], x, z, &pb[0], &pb[1]);
+        applyHomography(t, pa[0], pa[1], &pt[0], &pt[1]);
+        error = fmax(error, hypot(pt[0] - pb[0], pt[1] - pb[1]));
+    }
+    return error;
+}
+
+/**
+ * Sums two aggregated projections on the detector of the first one, over a window.
+ * Returns 0 if the arrays cannot be allocated, 1 otherwise.
+ * 'a' and 'b' are the pointers to the aggregated projections.
+ * 't' is the homography transferring the detector of 'a' onto the detector of 'b'.
+ * 'window' is the window of the sum, as returned by getBoxFootprint.
+ * 'sum' is the pointer on which to store the aggregated projection, which owns its arrays.
+ */
+int mergeAggregates(const struct aggregateView *a, const struct aggregateView *b, double t[3][3], const int window[4], struct aggregateView *sum){
+    const int width = window[2] - window[0];
+    const int height = window[3] - window[1];
+    double *arrays = (double*)malloc(sizeof(double) * 2 * width * height);
+    if(!arrays)
+        return 0;
+    for(int r = 0; r < height; r++){
+        for(int c = 0; c < width; c++){
+            //the pixels of the first projection are on the grid of the sum
+            const int ca = window[0] + c - a->c0, ra = window[1] + r - a->r0;
+            const int insideA = ca >= 0 && ra >= 0 && ca < a->width && ra < a->height;
+            double value = insideA ? a->value[(size_t)ra * a->stride + ca] : 0;
+            double count = insideA ? (a->count ? a->count[(size_t)ra * a->stride + ca] : 1) : 0;
+            double transferred[2];
+            applyHomography(t, window[0] + c, window[1] + r, &transferred[0], &transferred[1]);
+            sampleAggregate(b, transferred[0], transferred[1], &value, &count);
+            arrays[(size_t)r * width + c] = value;
+            arrays[(size_t)(height + r) * width + c] = count;
+        }
+    }
+    *sum = *a;
+    sum->c0 = window[0];
+    sum->r0 = window[1];
+    sum->width = width;
+    sum->height = height;
+    sum->stride = width;
+    sum->value = arrays;
+    sum->count = arrays + (size_t)width * height;
+    sum->owned = arrays;
+    return 1;
+}
+
+/**
+ * Backprojects aggregated projections into a box of the planes, as the shift-and-add reconstruction.
+ * 'views' is the array of aggregated projections, 'nViews' their number.
+ * 'box' is the pointer to the box.
+ * 'slices' and 'counts' are the arrays of the sums and numbers of projections of each voxel of the planes.
+ */
+void backprojectAggregates(const struct aggregateView *views, int nViews, const struct planeBox *box, double *slices, double *counts){
+    for(int s = box->first[0]; s < box->last[0]; s++){
+        for(int v = 0; v < nViews; v++){
+            double (*h)[3] = views[v].homographies[s];
+            const int first = box->first[2];
+            const int length = box->last[2] - first;
+            double colCoord[length], rowCoord[length];
+            for(int i = box->first[1]; i < box->last[1]; i++){
+                const double z = getZPlane(i) + VOXEL_Z / 2.0;
+                const double x0 = getXPlane(0) + VOXEL_X / 2.0;
+                const size_t row = ((size_t)s * nVoxel[Z] + i) * nVoxel[X] + first;
+                //maps the row of the box onto the detector, then interpolates
+#pragma omp simd
+                for(int j = 0; j < length; j++){
+                    const double x = x0 + (first + j) * VOXEL_X;
+                    const double w = h[2][0] * x + h[2][1] * z + h[2][2];
+                    colCoord[j] = (h[0][0] * x + h[0][1] * z + h[0][2]) / w;
+                    rowCoord[j] = (h[1][0] * x + h[1][1] * z + h[1][2]) / w;
+                }
+                for(int j = 0; j < length; j++){
+                    sampleAggregate(&views[v], colCoord[j], rowCoord[j], &slices[row + j], &counts[row + j]);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Reconstructs a box of the planes with the hierarchical backprojection: the box is split in halves along each of its
+ * dimensions, and for each half the pairs of consecutive projections are summed over the half's footprint when the
+ * transfer error is within the tolerance, or restricted to the footprint otherwise. The halves are reconstructed
+ * as parallel tasks.
+ * 'views' is the array of aggregated projections, 'nViews' their number.
+ * 'box' is the pointer to the box.
+ * 'tolerance' is the largest transfer error allowed for a sum, in pixels.
+ * 'slices' and 'counts' are the arrays of the sums and numbers of projections of each voxel of the planes.
+*/
+void backprojectBox(const struct aggregateView *views, int nViews, const struct planeBox *box, double tolerance, double *slices, double *counts){
+    int size[3];
+    size_t nVoxels = 1;
+    for(int d = 0; d < 3; d++){
+        size[d] = box->last[d] - box->first[d];
+        nVoxels *= size[d];
+    }
+    if(nViews <= 1 || (size[0] <= AGGREGATE_LEAF && size[1] <= AGGREGATE_LEAF && size[2] <= AGGREGATE_LEAF)){
+        backprojectAggregates(views, nViews, box, slices, counts);
+        return;
+    }
+
+    for(int half = 0; half < 8; half++){
+        struct planeBox child;
+        int empty = 0;
+        for(int d = 0; d < 3; d++){
+            const int middle = box->first[d] + size[d] / 2;
+            child.first[d] = half & (1 << d) ? middle : box->first[d];
+            child.last[d] = half & (1 << d) ? box->last[d] : (size[d] > 1 ? middle : box->last[d]);
+            empty |= child.first[d] >= child.last[d] || (size[d] == 1 && half & (1 << d));
+        }
+        if(empty)
+            continue;
+#pragma omp task default(none) firstprivate(views, nViews, child, tolerance, slices, counts) if(nVoxels > AGGREGATE_TASK_VOXELS)
+        {
+            struct aggregateView *childViews = (struct aggregateView*)calloc(nViews, sizeof(struct aggregateView));
+            int nChildViews = 0;
+            for(int v = 0; v < nViews; v += 2){
+                int window[4], windowB[4];
+                struct aggregateView a, b;
+                getBoxFootprint(&views[v], &child, window);
+                const int hasA = cropAggregate(&views[v], window, &a);
+                int hasB = 0;
+                if(v + 1 < nViews){
+                    getBoxFootprint(&views[v + 1], &child, windowB);
+                    hasB = cropAggregate(&views[v + 1], windowB, &b);
+                }
+                //even an exact transfer resamples the second projection, a zero tolerance sums none
+                if(hasA && hasB && tolerance > 0){
+                    double t[3][3];
+                    getTransferHomography(&a, &b, (child.first[0] + child.last[0] - 1) / 2, t);
+                    if(getTransferError(&a, &b, t, &child) <= tolerance && mergeAggregates(&a, &b, t, window, &childViews[nChildViews])){
+                        nChildViews++;
+                        continue;
+                    }
+                }
+                if(hasA)
+                    childViews[nChildViews++] = a;
+                if(hasB)
+                    childViews[nChildViews++] = b;
+            }
+            backprojectBox(childViews, nChildViews, &child, tolerance, slices, counts);
+            for(int v = 0; v < nChildViews; v++){
+                free(childViews[v].owned);
+            }
+            free(childViews);
+        }
+    }
+#pragma omp taskwait
+}
+
+/**
+ * Reconstructs planes parallel to the XZ plane with the hierarchical backprojection, which approximates the
+ * shift-and-add reconstruction of reconstructTomosynthesis.
+ * Returns 1 on success, 0 otherwise.
+ * 'absorbment' is the array containing the (possibly filtered) projections.
+ * 'depths' is the array containing the y coordinate of each plane.
+ * 'nSlices' is the number of planes.
+ * 'tolerance' is the largest transfer error allowed when summing projections, in pixels; 0 sums none.
+ * 'slices' is the array on which to store the planes, each plane has nVoxel[Z] rows and nVoxel[X] columns.
+*/
+int reconstructHierarchical(double *absorbment, double *depths, int nSlices, double tolerance, double *slices){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    const size_t length = (size_t)nSlices * nVoxel[Z] * nVoxel[X];
+    double *counts = (double*)calloc(length, sizeof(double));
+    double (*homographies)[3][3] = (double(*)[3][3])malloc(sizeof(double[3][3]) * (nTheta + 1) * nSlices);
+    struct aggregateView views[nTheta + 1];
+    const struct planeBox box = {{0, 0, 0}, {nSlices, nVoxel[Z], nVoxel[X]}};
+
+    if(!counts || !homographies){
+        fprintf(stderr,"Cannot allocate the hierarchical backprojection\n");
+        free(counts);
+        free(homographies);
+        return 0;
+    }
+    //each projection starts as an aggregate of itself over the whole detector
+    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+        const struct aggregateView view = {
+            homographies + (size_t)positionIndex * nSlices,
+            0, 0, nSidePixels, nSidePixels, nSidePixels,
+            absorbment + (size_t)positionIndex * nSidePixels * nSidePixels, NULL, NULL
+        };
+        views[positionIndex] = view;
+        for(int s = 0; s < nSlices; s++){
+            getPlaneHomography(positionIndex, stationaryDetector ? nTheta / 2 : positionIndex, depths[s], views[positionIndex].homographies[s]);
+        }
+    }
+    memset(slices, 0, sizeof(double) * length);
+
+#pragma omp parallel default(none) shared(views, nTheta, box, tolerance, slices, counts)
+#pragma omp single
+    backprojectBox(views, nTheta + 1, &box, tolerance, slices, counts);
+
+#pragma omp parallel for schedule(static) default(none) shared(slices, counts, length)
+    for(size_t i = 0; i < length; i++){
+        if(counts[i] > 0)
+            slices[i] /= counts[i];
+    }
+    free(counts);
+    free(homographies);
+    return 1;
+}
+
+/**
+ * Computes the (fractional) detector coordinates of the projection of a point.
+ * Returns 1 if the projection exists, 0 otherwise.
+ * 'frame' is the geometry of the angular position.
+ * 'p' is the point to be projected.
+ * 'c' and 'r' are the pointers on which to store the column and the row of the projection.
+*/
+int projectPoint(const struct detectorFrame *frame, struct point p, double *c, double *r){
+    //solves source + t(p - source) = origin + c colStep + r rowStep with Cramer's rule
+    const struct point d = sub(frame->source, p);
+    const struct point w = sub(frame->source, frame->origin);
+    const double det = dot(frame->colStep, cross(frame->rowStep, d));
+    if(det == 0)
+        return 0;
+    *c = dot(w, cross(frame->rowStep, d)) / det;
+    *r = dot(frame->colStep, cross(w, d)) / det;
+    return 1;
+}
+
+/**
+ * Locates the projection of a ball as the centroid of the values above the middle of the range of a window.
+ * Returns 1 if the ball is found, 0 otherwise.
+ * 'absorbment' is the array containing the projections.
+ * 'view' is the index of the projection.
+ * 'c0' and 'r0' are the expected column and row of the projection of the ball.
+ * 'halfSide' is the half side of the window, in pixels.
+ * 'c' and 'r' are the pointers on which to store the column and the row of the centroid.
+*/
+int findBall(const double *absorbment, int view, double c0, double r0, int halfSide, double *c, double *r){
+    const int firstCol = (int)c0 - halfSide, lastCol = (int)c0 + halfSide;
+    const int firstRow = (int)r0 - halfSide, lastRow = (int)r0 + halfSide;
+    double vmin = INFINITY, vmax = -INFINITY;
+
+    if(firstCol < 0 || firstRow < 0 || lastCol >= nSidePixels || lastRow >= nSidePixels)
+        return 0;
+
+    for(int i = firstRow; i <= lastRow; i++){
+        for(int j = firstCol; j <= lastCol; j++){
+            const double value = absorbment[getPixelIndex(projectionLayout, view, i, j)];
+            vmin = fmin(vmin, value);
+            vmax = fmax(vmax, value);
+        }
+    }
+    if(vmax - vmin <= 0)
+        return 0;
+
+    const double threshold = (vmin + vmax) / 2;
+    double sum = 0, sumC = 0, sumR = 0;
+    for(int i = firstRow; i <= lastRow; i++){
+        for(int j = firstCol; j <= lastCol; j++){
+            const double weight = absorbment[getPixelIndex(projectionLayout, view, i, j)] - threshold;
+            if(weight > 0){
+                sum += weight;
+                sumC += weight * j;
+                sumR += weight * i;
+            }
+        }
+    }
+    *c = sumC / sum;
+    *r = sumR / sum;
+    return 1;
+}
+
+/**
+ * Returns the alignment described by a vector of calibration parameters.
+ */
+struct alignment getAlignment(const double *params){
+    struct alignment a;
+    a.offsetU = params[0];
+    a.offsetV = params[1];
+    a.tilt = params[2];
+    a.skew = params[3];
+    a.sourceDistance = params[4];
+    return a;
+}
+
+/**
+ * Computes the sum of the squared reprojection errors of the balls and, optionally, the normal equations of
+ * the Gauss-Newton step; the Jacobian is obtained with forward differences. The views are processed in parallel.
+ * 'params' is the vector of calibration parameters.
+ * 'observed' is the array containing the detected column and row of each ball in each view.
+ * 'valid' is the array flagging the balls that have been detected.
+ * 'jtj' and 'jtr' are the arrays on which to store J'J and J'r, NULL to compute the error only.
+*/
+double getReprojectionError(const double *params, const double *observed, const int *valid, double *jtj, double *jtr){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    const double step[N_CALIBRATION_PARAMS] = {1e-3 * PIXEL, 1e-3 * PIXEL, 1e-7, 1e-7, 1e-3 * PIXEL};
+    double a[N_CALIBRATION_PARAMS * N_CALIBRATION_PARAMS] = {0};
+    double b[N_CALIBRATION_PARAMS] = {0};
+    double error = 0;
+
+#pragma omp parallel for default(none) shared(params, observed, valid, jtj, step, nTheta, stationaryDetector, VOXEL_MAT) reduction(+:error, a[:N_CALIBRATION_PARAMS * N_CALIBRATION_PARAMS], b[:N_CALIBRATION_PARAMS])
+    for(int view = 0; view <= nTheta; view++){
+        const int detectorIndex = stationaryDetector ? nTheta / 2 : view;
+        struct detectorFrame frame, perturbed[N_CALIBRATION_PARAMS];
+        const struct alignment nominal = getAlignment(params);
+        getDetectorFrame(&nominal, view, detectorIndex, &frame);
+        if(jtj){
+            for(int k = 0; k < N_CALIBRATION_PARAMS; k++){
+                double shifted[N_CALIBRATION_PARAMS];
+                memcpy(shifted, params, sizeof(shifted));
+                shifted[k] += step[k];
+                const struct alignment trial = getAlignment(shifted);
+                getDetectorFrame(&trial, view, detectorIndex, &perturbed[k]);
+            }
+        }
+
+        for(int ball = 0; ball < N_BALLS; ball++){
+            const int index = view * N_BALLS + ball;
+            const struct point center = getBallCenter(ball, VOXEL_MAT);
+            double c, r;
+            if(!valid[index] || !projectPoint(&frame, center, &c, &r))
+                continue;
+            const double residual[2] = {c - observed[2 * index], r - observed[2 * index + 1]};
+            error += residual[0] * residual[0] + residual[1] * residual[1];
+
+            if(jtj){
+                double jacobian[2][N_CALIBRATION_PARAMS];
+                for(int k = 0; k < N_CALIBRATION_PARAMS; k++){
+                    double pc = c, pr = r;
+                    projectPoint(&perturbed[k], center, &pc, &pr);
+                    jacobian[0][k] = (pc - c) / step[k];
+                    jacobian[1][k] = (pr - r) / step[k];
+                }
+                for(int i = 0; i < N_CALIBRATION_PARAMS; i++){
+                    for(int j = 0; j < N_CALIBRATION_PARAMS; j++){
+                        a[i * N_CALIBRATION_PARAMS + j] += jacobian[0][i] * jacobian[0][j] + jacobian[1][i] * jacobian[1][j];
+                    }
+                    b[i] += jacobian[0][i] * residual[0] + jacobian[1][i] * residual[1];
+                }
+            }
+        }
+    }
+
+    if(jtj){
+        memcpy(jtj, a, sizeof(a));
+        memcpy(jtr, b, sizeof(b));
+    }
+    return error;
+}
+
+/**
+ * Solves the linear system 'a' x = 'b' by Gaussian elimination with partial pivoting.
+ * Returns 1 on success, 0 if the matrix is singular.
+ * 'a' is the 'n' x 'n' matrix, it is overwritten.
+ * 'b' is the known terms vector, it is overwritten with the solution.
+*/
+int solveLinearSystem(double *a, double *b, int n){
+    for(int k = 0; k < n; k++){
+        int pivot = k;
+        for(int i = k + 1; i < n; i++){
+            if(fabs(a[i * n + k]) > fabs(a[pivot * n + k]))
+                pivot = i;
+        }
+        if(a[pivot * n + k] == 0)
+            return 0;
+        for(int j = 0; j < n; j++){
+            const double temp = a[k * n + j];
+            a[k * n + j] = a[pivot * n + j];
+            a[pivot * n + j] = temp;
+        }
+        const double temp = b[k];
+        b[k] = b[pivot];
+        b[pivot] = temp;
+
+        for(int i = k + 1; i < n; i++){
+            const double factor = a[i * n + k] / a[k * n + k];
+            for(int j = k; j < n; j++){
+                a[i * n + j] -= factor * a[k * n + j];
+            }
+            b[i] -= factor * b[k];
+        }
+    }
+    for(int k = n - 1; k >= 0; k--){
+        for(int j = k + 1; j < n; j++){
+            b[k] -= a[k * n + j] * b[j];
+        }
+        b[k] /= a[k * n + k];
+    }
+    return 1;
+}
+
+/**
+ * Fits the calibration parameters minimising the reprojection error with the Levenberg-Marquardt method.
+ * Returns the final sum of squared reprojection errors.
+ * 'params' is the vector of calibration parameters, it holds the initial guess and is overwritten with the result.
+ * 'observed' is the array containing the detected column and row of each ball in each view.
+ * 'valid' is the array flagging the balls that have been detected.
+*/
+double fitCalibration(double *params, const double *observed, const int *valid){
+    double jtj[N_CALIBRATION_PARAMS * N_CALIBRATION_PARAMS], jtr[N_CALIBRATION_PARAMS];
+    double lambda = 1e-3;
+    double error = getReprojectionError(params, observed, valid, jtj, jtr);
+
+    for(int iteration = 0; iteration < CALIBRATION_ITERATIONS && lambda < 1e12; iteration++){
+        double a[N_CALIBRATION_PARAMS * N_CALIBRATION_PARAMS], delta[N_CALIBRATION_PARAMS], trial[N_CALIBRATION_PARAMS];
+        memcpy(a, jtj, sizeof(a));
+        for(int k = 0; k < N_CALIBRATION_PARAMS; k++){
+            a[k * N_CALIBRATION_PARAMS + k] *= 1 + lambda;
+            delta[k] = -jtr[k];
+        }
+        if(!solveLinearSystem(a, delta, N_CALIBRATION_PARAMS)){
+            lambda *= 10;
+            continue;
+        }
+        for(int k = 0; k < N_CALIBRATION_PARAMS; k++){
+            trial[k] = params[k] + delta[k];
+        }
+
+        const double trialError = getReprojectionError(trial, observed, valid, NULL, NULL);
+        if(trialError < error){
+            const double decrease = error - trialError;
+            memcpy(params, trial, sizeof(trial));
+            error = getReprojectionError(params, observed, valid, jtj, jtr);
+            lambda /= 10;
+            if(decrease < 1e-12 * error)
+                break;
+        } else {
+            lambda *= 10;
+        }
+    }
+    return error;
+}
+
+/**
+ * Estimates the scanner alignment from the projections of the ball calibration phantom.
+ * The balls are located in each view around their predicted position and the alignment is fitted to the
+ * detected positions; the detection is repeated around the positions predicted by the fitted alignment.
+ * Returns the root mean square reprojection error, in pixels.
+ * 'absorbment' is the array containing the projections of the phantom.
+ * 'fitted' is the pointer to the structure on which to store the estimated alignment.
+*/
+double calibrateGeometry(const double *absorbment, struct alignment *fitted){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    const int nBalls = (nTheta + 1) * N_BALLS;
+    double *observed = (double*)malloc(sizeof(double) * 2 * nBalls);
+    int *valid = (int*)malloc(sizeof(int) * nBalls);
+    double params[N_CALIBRATION_PARAMS] = {0};
+    double error = 0;
+    int nValid = 0;
+
+    //projected radius of the balls, in pixels
+    const int ballRadius = (int)ceil(BALL_RADIUS * VOXEL_MAT * (DOS + DOD) / DOS / PIXEL);
+
+    for(int round = 0; round < 2; round++){
+        const struct alignment current = getAlignment(params);
+        nValid = 0;
+#pragma omp parallel for default(none) shared(absorbment, observed, valid, current, ballRadius, nTheta, stationaryDetector, VOXEL_MAT) reduction(+:nValid)
+        for(int view = 0; view <= nTheta; view++){
+            struct detectorFrame frame;
+            getDetectorFrame(&current, view, stationaryDetector ? nTheta / 2 : view, &frame);
+            for(int ball = 0; ball < N_BALLS; ball++){
+                const int index = view * N_BALLS + ball;
+                double c0, r0;
+                valid[index] = projectPoint(&frame, getBallCenter(ball, VOXEL_MAT), &c0, &r0) &&
+                               findBall(absorbment, view, c0, r0, ballRadius + CALIBRATION_SEARCH, &observed[2 * index], &observed[2 * index + 1]);
+                nValid += valid[index];
+            }
+        }
+        error = fitCalibration(params, observed, valid);
+    }
+
+    *fitted = getAlignment(params);
+    free(observed);
+    free(valid);
+    return nValid > 0 ? sqrt(error / nValid) : INFINITY;
+}
+
+/**
+ * Returns the median of nine values.
+ */
+double median9(double *p){
+    //sorting network, only the comparisons needed to find the median are performed
+#define SORT2(a, b) { const double lo = fmin(p[a], p[b]); p[b] = fmax(p[a], p[b]); p[a] = lo; }
+    SORT2(1, 2); SORT2(4, 5); SORT2(7, 8);
+    SORT2(0, 1); SORT2(3, 4); SORT2(6, 7);
+    SORT2(1, 2); SORT2(4, 5); SORT2(7, 8);
+    SORT2(0, 3); SORT2(5, 8); SORT2(4, 7);
+    SORT2(3, 6); SORT2(1, 4); SORT2(2, 5);
+    SORT2(4, 7); SORT2(4, 2); SORT2(6, 4);
+    SORT2(4, 2);
+#undef SORT2
+    return p[4];
+}
+
+/**
+ * Converts the raw intensities of a projection into transmission values using flat and dark field images.
+ * 'view' is the projection, it is overwritten with the transmission values.
+ * 'flat' is the flat field image, NULL if not available.
+ * 'dark' is the dark field image, NULL if not available.
+*/
+void normaliseView(double *view, const double *flat, const double *dark){
+#pragma omp parallel for default(none) shared(view, flat, dark, nSidePixels)
+    for(int r = 0; r < nSidePixels; r++){
+        double *row = view + (size_t)r * nSidePixels;
+        const double *flatRow = flat ? flat + (size_t)r * nSidePixels : NULL;
+        const double *darkRow = dark ? dark + (size_t)r * nSidePixels : NULL;
+#pragma omp simd
+        for(int c = 0; c < nSidePixels; c++){
+            const double d = darkRow ? darkRow[c] : 0;
+            const double gain = (flatRow ? flatRow[c] : 1) - d;
+            row[c] = gain > 0 ? (row[c] - d) / gain : 0;
+        }
+    }
+}
+
+/**
+ * Replaces dead pixels and outliers of a projection with the median of their 3x3 neighbourhood.
+ * 'view' is the projection.
+ * 'dead' is the mask of dead pixels, NULL if not available.
+ * 'threshold' is the relative deviation from the median above which a pixel is considered an outlier, 0 disables the check.
+ * 'scratch' is an array of the size of a projection used as temporary storage.
+*/
+void correctOutliers(double *view, const unsigned char *dead, double threshold, double *scratch){
+#pragma omp parallel for default(none) shared(view, dead, threshold, scratch, nSidePixels)
+    for(int r = 0; r < nSidePixels; r++){
+        for(int c = 0; c < nSidePixels; c++){
+            const size_t index = (size_t)r * nSidePixels + c;
+            const int isDead = dead && dead[index];
+            scratch[index] = view[index];
+            if(isDead || threshold > 0){
+                double neighbours[9];
+                for(int k = 0; k < 9; k++){
+                    //clamps the neighbourhood to the detector's border
+                    const int nr = r + k / 3 - 1 < 0 ? 0 : min(r + k / 3 - 1, nSidePixels - 1);
+                    const int nc = c + k % 3 - 1 < 0 ? 0 : min(c + k % 3 - 1, nSidePixels - 1);
+                    neighbours[k] = view[(size_t)nr * nSidePixels + nc];
+                }
+                const double median = median9(neighbours);
+                if(isDead || fabs(view[index] - median) > threshold * fabs(median)){
+                    scratch[index] = median;
+                }
+            }
+        }
+    }
+    memcpy(view, scratch, sizeof(double) * nSidePixels * nSidePixels);
+}
+
+/**
+ * Converts the transmission values of a projection into line integrals of the absorption coefficient.
+ * 'view' is the projection.
+*/
+void logTransformView(double *view){
+#pragma omp parallel for default(none) shared(view, nSidePixels)
+    for(int r = 0; r < nSidePixels; r++){
+        double *row = view + (size_t)r * nSidePixels;
+#pragma omp simd
+        for(int c = 0; c < nSidePixels; c++){
+            row[c] = -log(fmax(row[c], PREPROCESS_MIN_TRANSMISSION));
+        }
+    }
+}
+
+/**
+ * Suppresses ring artifacts by removing from every projection the high-frequency part of the mean projection,
+ * which is caused by pixels with a response that differs from their neighbours.
+ * 'absorbment' is the array containing the projections in projection order.
+ * 'nViews' is the number of projections.
+ * 'width' is the half width of the moving average used to smooth the mean projection along the rows.
+*/
+void suppressRings(double *absorbment, int nViews, int width){
+    double *mean = (double*)calloc((size_t)nSidePixels * nSidePixels, sizeof(double));
+    double *profile = (double*)malloc(sizeof(double) * nSidePixels * nSidePixels);
+
+    //accumulates the mean projection a view at a time
+    for(int view = 0; view < nViews; view++){
+        const double *p = absorbment + (size_t)view * nSidePixels * nSidePixels;
+#pragma omp parallel for simd default(none) shared(p, mean, nSidePixels, nViews)
+        for(size_t i = 0; i < (size_t)nSidePixels * nSidePixels; i++){
+            mean[i] += p[i] / nViews;
+        }
+    }
+
+    //ring profile: difference between the mean projection and its moving average along the rows
+#pragma omp parallel for default(none) shared(mean, profile, width, nSidePixels)
+    for(int r = 0; r < nSidePixels; r++){
+        const double *row = mean + (size_t)r * nSidePixels;
+        for(int c = 0; c < nSidePixels; c++){
+            const int first = c - width < 0 ? 0 : c - width;
+            const int last = min(c + width, nSidePixels - 1);
+            double sum = 0;
+            for(int k = first; k <= last; k++){
+                sum += row[k];
+            }
+            profile[(size_t)r * nSidePixels + c] = row[c] - sum / (last - first + 1);
+        }
+    }
+
+    for(int view = 0; view < nViews; view++){
+        double *p = absorbment + (size_t)view * nSidePixels * nSidePixels;
+#pragma omp parallel for simd default(none) shared(p, profile, nSidePixels)
+        for(size_t i = 0; i < (size_t)nSidePixels * nSidePixels; i++){
+            p[i] -= profile[i];
+        }
+    }
+
+    free(mean);
+    free(profile);
+}
+
+/**
+ * Reads an image of the size of the detector stored as raw doubles.
+ * Returns 1 on success, 0 otherwise.
+ * 'file' is the file to read from.
+ * 'image' is the array on which to store the image.
+*/
+int readImage(FILE *file, double *image){
+    return fread(image, sizeof(double), (size_t)nSidePixels * nSidePixels, file) == (size_t)nSidePixels * nSidePixels;
+}
+
+/**
+ * Reads raw projections and converts them into line integrals, a projection at a time.
+ * Flat/dark field normalisation, dead pixel and outlier correction and -log conversion are applied to each projection
+ * as soon as it is read; ring suppression is applied once all the projections are available.
+ * Returns 1 on success, 0 otherwise.
+ * 'inputPath' is the path of the file containing the raw projections, stored as doubles in projection order.
+ * 'flatPath' and 'darkPath' are the paths of the flat and dark field images, NULL if not available.
+ * 'outlierThreshold' is the relative deviation above which a pixel is replaced by the median of its neighbours, 0 disables it.
+ * 'ringWidth' is the half width of the smoothing used by the ring suppression, 0 disables it.
+ * 'absorbment' is the array on which to store the projections, in projection order.
+*/
+int preprocessProjections(const char *inputPath, const char *flatPath, const char *darkPath, double outlierThreshold, int ringWidth, double *absorbment){
+    const int nViews = (int)(AP / STEP_ANGLE) + 1;
+    const size_t viewSize = (size_t)nSidePixels * nSidePixels;
+    double *flat = NULL;
+    double *dark = NULL;
+    unsigned char *dead = NULL;
+    double *scratch = (double*)malloc(sizeof(double) * viewSize);
+    int ok = 1;
+
+    FILE *input = fopen(inputPath, "rb");
+    if(!input){
+        fprintf(stderr, "Cannot open %s\n", inputPath);
+        free(scratch);
+        return 0;
+    }
+    if(flatPath){
+        FILE *file = fopen(flatPath, "rb");
+        flat = (double*)malloc(sizeof(double) * viewSize);
+        ok = ok && file && readImage(file, flat);
+        if(file)
+            fclose(file);
+    }
+    if(darkPath){
+        FILE *file = fopen(darkPath, "rb");
+        dark = (double*)malloc(sizeof(double) * viewSize);
+        ok = ok && file && readImage(file, dark);
+        if(file)
+            fclose(file);
+    }
+
+    //pixels without response in the flat field are dead
+    if(ok && flat){
+        dead = (unsigned char*)malloc(viewSize);
+        for(size_t i = 0; i < viewSize; i++){
+            dead[i] = flat[i] - (dark ? dark[i] : 0) <= 0;
+        }
+    }
+
+    for(int view = 0; ok && view < nViews; view++){
+        double *p = absorbment + view * viewSize;
+        if(!readImage(input, p)){
+            ok = 0;
+            break;
+        }
+        normaliseView(p, flat, dark);
+        if(dead || outlierThreshold > 0)
+            correctOutliers(p, dead, outlierThreshold, scratch);
+        logTransformView(p);
+    }
+    if(!ok){
+        fprintf(stderr, "Cannot read the raw projections\n");
+    } else if(ringWidth > 0){
+        suppressRings(absorbment, nViews, ringWidth);
+    }
+
+    fclose(input);
+    free(flat);
+    free(dark);
+    free(dead);
+    free(scratch);
+    return ok;
+}
+
+/**
+ * Computes the minimum and maximum of an array.
+ * 'values' is the array.
+ * 'length' is the length of the array.
+ * 'min' and 'max' are the pointers on which to store the results.
+*/
+void getMinMax(const double *values, size_t length, double *min, double *max){
+    double vmax = -INFINITY;
+    double vmin = INFINITY;
+#pragma omp parallel for simd default(none) shared(values, length) reduction(min:vmin) reduction(max:vmax)
+    for(size_t i = 0; i < length; i++){
+        vmax = fmax(vmax, values[i]);
+        vmin = fmin(vmin, values[i]);
+    }
+    *min = vmin;
+    *max = vmax;
+}
+
+//models the mapping of the absorption values of a stack of images onto grey levels
+struct outputScale{
+    enum window window;
+    double min;                 //value mapped to black
+    double max;                 //value mapped to white
+    double gamma;
+    double maxLevel;            //grey level of white
+    int dither;
+};
+
+//4x4 Bayer matrix of the ordered dithering, thresholds in sixteenths of a grey level
+const double ditherThresholds[4][4] = {
+    {0.5 / 16, 8.5 / 16, 2.5 / 16, 10.5 / 16},
+    {12.5 / 16, 4.5 / 16, 14.5 / 16, 6.5 / 16},
+    {3.5 / 16, 11.5 / 16, 1.5 / 16, 9.5 / 16},
+    {15.5 / 16, 7.5 / 16, 13.5 / 16, 5.5 / 16}
+};
+
+/**
+ * Maps a row of values onto grey levels between [0-maxLevel]: the values are windowed, then either truncated or,
+ * when dithering, rounded against the Bayer threshold of their pixel.
+ * 'values' is the array of values.
+ * 'colors' is the array on which to store the grey levels.
+ * 'length' is the length of the arrays.
+ * 'row' is the index of the row in the image, it selects the thresholds of the dithering.
+ * 'scale' is the pointer to the mapping.
+*/
+KERNEL_INLINE void quantiseKernel(const double *values, int *colors, int length, int row, const struct outputScale *scale){
+    const double min = scale->min;
+    const double range = scale->max - scale->min;
+    const double maxLevel = scale->maxLevel;
+    const double *thresholds = ditherThresholds[row & 3];
+    const double bias = scale->dither ? 1 : 0;
+
+    if(scale->window == LOG_WINDOW){
+        const double logScale = maxLevel / log1p(LOG_WINDOW_GAIN);
+#pragma omp simd
+        for(int i = 0; i < length; i++){
+            const double level = log1p(LOG_WINDOW_GAIN * fmax((values[i] - min) / range, 0)) * logScale + bias * thresholds[i & 3];
+            colors[i] = fmin(fmax(level, 0), maxLevel);
+        }
+    } else if(scale->window == GAMMA_WINDOW){
+        const double exponent = 1 / scale->gamma;
+#pragma omp simd
+        for(int i = 0; i < length; i++){
+            const double level = pow(fmax((values[i] - min) / range, 0), exponent) * maxLevel + bias * thresholds[i & 3];
+            colors[i] = fmin(fmax(level, 0), maxLevel);
+        }
+    } else {
+#pragma omp simd
+        for(int i = 0; i < length; i++){
+            const double level = (values[i] - min) * maxLevel / range + bias * thresholds[i & 3];
+            colors[i] = fmin(fmax(level, 0), maxLevel);
+        }
+    }
+}
+
+//instantiates the scaling of the output for an instruction set
+#define QUANTISE_VARIANT(name, target) \
+target void name(const double *values, int *colors, int length, int row, const struct outputScale *scale){ \
+    quantiseKernel(values, colors, length, row, scale); \
+}
+
+ISA_VARIANTS(QUANTISE_VARIANT, quantiseValues)
+void (*quantiseVariants[N_ISAS])(const double *, int *, int, int, const struct outputScale *) = ISA_TABLE(quantiseValues);
+
+//scaling of the output selected for the CPU
+void (*quantiseOutput)(const double *, int *, int, int, const struct outputScale *) = quantiseValues;
+
+/**
+ * Formats a row of grey levels as the text of a P2 image: a new line, then each level followed by a space.
+ * Returns the number of characters written.
+ * 'colors' is the array of grey levels, between [0-255].
+ * 'length' is the length of the array.
+ * 'text' is the array on which to write the text, of at least 1 + 4 'length' characters.
+*/
+int formatRow(const int *colors, int length, char *text){
+    char *p = text;
+    *p++ = '\n';
+    for(int i = 0; i < length; i++){
+        const int c = colors[i];
+        if(c >= 100)
+            *p++ = '0' + c / 100;
+        if(c >= 10)
+            *p++ = '0' + c / 10 % 10;
+        *p++ = '0' + c % 10;
+        *p++ = ' ';
+    }
+    return p - text;
+}
+
+/**
+ * Writes the header of a pgm image in the output format.
+ * 'file' is the output file.
+ * 'width' and 'height' are the sides of the image.
+ * 'scale' is the pointer to the mapping of the values, it gives the grey level of white.
+*/
+void writePGMHeader(FILE *file, int width, int height, const struct outputScale *scale){
+    if(outputFormat == ASCII_PIXELS){
+        fprintf(file, "P2\n%d %d\n255", width, height);
+    } else {
+        fprintf(file, "P5\n%d %d\n%d\n", width, height, (int)scale->maxLevel);
+    }
+}
+
+/**
+ * Converts an image to grey levels, the rows in parallel, and writes it in the output format.
+ * 'file' is the output file.
+ * 'image' is the array of values, stored as [row][column].
+ * 'width' and 'height' are the sides of the image.
+ * 'firstRow' is the index of the first row of the image in the printed stack, it selects the thresholds of the dithering.
+ * 'scale' is the pointer to the mapping of the values.
+ * 'buffer' is an array of at least 'height' (1 + 4 'width') bytes, 'rowLength' an array of 'height' elements.
+*/
+void writePGMImage(FILE *file, const double *image, int width, int height, size_t firstRow, const struct outputScale *scale,
+                   unsigned char *buffer, int *rowLength){
+    //each row of text takes at most a new line and four characters per value
+    const size_t rowStride = outputFormat == ASCII_PIXELS ? 1 + 4 * (size_t)width : (outputFormat == BINARY_16BIT ? 2 : 1) * (size_t)width;
+
+#pragma omp parallel for schedule(static) default(none) shared(image, width, height, firstRow, scale, outputFormat, buffer, rowStride, rowLength, quantiseOutput)
+    for(int i = 0; i < height; i++){
+        int colors[width];
+        unsigned char *row = buffer + rowStride * i;
+        quantiseOutput(image + (size_t)i * width, colors, width, firstRow + i, scale);
+        if(outputFormat == ASCII_PIXELS){
+            rowLength[i] = formatRow(colors, width, (char*)row);
+        } else if(outputFormat == BINARY_16BIT){
+            for(int j = 0; j < width; j++){
+                row[2 * j] = colors[j] >> 8;
+                row[2 * j + 1] = colors[j] & 0xff;
+            }
+            rowLength[i] = 2 * width;
+        } else {
+            for(int j = 0; j < width; j++){
+                row[j] = colors[j];
+            }
+            rowLength[i] = width;
+        }
+    }
+    if(outputFormat == ASCII_PIXELS){
+        for(int i = 0; i < height; i++){
+            fwrite(buffer + rowStride * i, 1, rowLength[i], file);
+        }
+    } else {
+        fwrite(buffer, 1, rowStride * height, file);
+    }
+}
+
+/**
+ * Bins an image by 2x2: each value of the binned image is the mean of a 2x2 block, the last row or column of an odd side is dropped.
+ * 'image' is the array of values, stored as [row][column].
+ * 'width' and 'height' are the sides of the image.
+ * 'binned' is the array on which to store the binned image, of 'width' / 2 x 'height' / 2 values.
+*/
+void binImage(const double *image, int width, int height, double *binned){
+    const int binnedWidth = width / 2;
+#pragma omp parallel for schedule(static) default(none) shared(image, width, height, binned, binnedWidth)
+    for(int i = 0; i < height / 2; i++){
+        const double *top = image + (size_t)2 * i * width;
+        const double *bottom = top + width;
+#pragma omp simd
+        for(int j = 0; j < binnedWidth; j++){
+            binned[(size_t)i * binnedWidth + j] = 0.25 * (top[2 * j] + top[2 * j + 1] + bottom[2 * j] + bottom[2 * j + 1]);
+        }
+    }
+}
+
+/**
+ * Prints a stack of images as a pgm image, each value is mapped to a grey level by the output window and encoded
+ * in the output format.
+ * The images are converted one at a time, the rows of an image in parallel, and each image is written as soon as it is converted.
+ * When a pyramid is requested, each image is also binned by 2x2 and 4x4 while it is written, and the binned stacks are
+ * written on their own pgm images with the same mapping.
+ * 'image' is the array of values, stored as [image][row][column].
+ * 'width' and 'height' are the sides of each image.
+ * 'nImages' is the number of images.
+ * 'min' and 'max' are the values mapped to black and white.
+ * Returns 1 on success, 0 if the buffers of the conversion cannot be allocated.
+*/
+int printPGM(double *image, int width, int height, int nImages, double min, double max){
+    const struct outputScale scale = {outputWindow, min, max, outputGamma, outputFormat == BINARY_16BIT ? 65535 : 255, outputDither};
+    unsigned char *buffer = (unsigned char*)malloc((1 + 4 * (size_t)width) * height);
+    int *rowLength = (int*)malloc(sizeof(int) * height);
+    FILE *levelFiles[PYRAMID_LEVELS + 1] = {stdout};
+    double *levels[PYRAMID_LEVELS + 1] = {NULL};
+    int nLevels = 1;
+
+    if(!buffer || !rowLength){
+        fprintf(stderr,"Cannot allocate the pgm conversion buffers\n");
+        free(buffer);
+        free(rowLength);
+        return 0;
+    }
+
+    //the binned images of a level are computed from the ones of the previous level, a 2x2 bin of a 2x2 bin being a 4x4 bin
+    for(; pyramidPrefix && nLevels <= PYRAMID_LEVELS && (width >> nLevels) > 0 && (height >> nLevels) > 0; nLevels++){
+        char path[4096];
+        snprintf(path, sizeof(path), "%s-%dx%d.pgm", pyramidPrefix, 1 << nLevels, 1 << nLevels);
+        levelFiles[nLevels] = fopen(path, "wb");
+        levels[nLevels] = (double*)malloc(sizeof(double) * (width >> nLevels) * (height >> nLevels));
+        if(!levelFiles[nLevels] || !levels[nLevels]){
+            fprintf(stderr,"Cannot write %s\n", path);
+            if(levelFiles[nLevels])
+                fclose(levelFiles[nLevels]);
+            free(levels[nLevels]);
+            break;
+        }
+    }
+
+    for(int l = 0; l < nLevels; l++){
+        writePGMHeader(levelFiles[l], width >> l, (height >> l) * nImages, &scale);
+    }
+    for(int k = 0; k < nImages; k++){
+        levels[0] = image + (size_t)k * height * width;
+        for(int l = 0; l < nLevels; l++){
+            if(l > 0)
+                binImage(levels[l - 1], width >> (l - 1), height >> (l - 1), levels[l]);
+            writePGMImage(levelFiles[l], levels[l], width >> l, height >> l, (size_t)k * (height >> l), &scale, buffer, rowLength);
+        }
+    }
+    fflush(stdout);
+    for(int l = 1; l < nLevels; l++){
+        fclose(levelFiles[l]);
+        free(levels[l]);
+    }
+    free(buffer);
+    free(rowLength);
+    return 1;
+}
+
+/**
+ * Parses an option of the printed images.
+ * Returns 1 if the i-th argument is an option of the printed images, -1 if its value is unknown, 0 otherwise.
+ * 'argc' and 'argv' are the arguments.
+ * 'i' is the pointer to the index of the argument, moved to the last argument of the option.
+*/
+int parseOutputOption(int argc, char *argv[], int *i){
+    if(!strcmp(argv[*i], "--window") && *i + 1 < argc){
+        const char *window = argv[++*i];
+        if(!strcmp(window, "linear")){
+            outputWindow = LINEAR_WINDOW;
+        } else if(!strcmp(window, "log")){
+            outputWindow = LOG_WINDOW;
+        } else if(!strcmp(window, "gamma")){
+            outputWindow = GAMMA_WINDOW;
+        } else {
+            return -1;
+        }
+    } else if(!strcmp(argv[*i], "--gamma") && *i + 1 < argc){
+        outputGamma = atof(argv[++*i]);
+        outputWindow = GAMMA_WINDOW;
+    } else if(!strcmp(argv[*i], "--format") && *i + 1 < argc){
+        const char *format = argv[++*i];
+        if(!strcmp(format, "ascii")){
+            outputFormat = ASCII_PIXELS;
+        } else if(!strcmp(format, "8")){
+            outputFormat = BINARY_8BIT;
+        } else if(!strcmp(format, "16")){
+            outputFormat = BINARY_16BIT;
+        } else {
+            return -1;
+        }
+    } else if(!strcmp(argv[*i], "--dither")){
+        outputDither = 1;
+    } else if(!strcmp(argv[*i], "--pyramid") && *i + 1 < argc){
+        pyramidPrefix = argv[++*i];
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Reads the pose perturbation of each angular position from a text file.
+ * Each line contains the source shift (x y z), the detector shift (x y z) and the detector rotation about
+ * the x, y and z axes (degrees) of a position, in the reference coordinate system; missing lines leave the position unperturbed.
+ * Returns 1 on success, 0 otherwise.
+ * 'path' is the path of the file.
+*/
+int readPerturbations(const char *path){
+    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
+    FILE *file = fopen(path, "r");
+    if(!file){
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 0;
+    }
+    char line[1024];
+    for(int positionIndex = 0; positionIndex <= nTheta && fgets(line, sizeof(line), file); positionIndex++){
+        struct perturbation *p = &view_perturbation[positionIndex];
+        double rotation[3];
+        int length = 0;
+        //a line holds the nine values and nothing else
+        if(sscanf(line, "%lf %lf %lf %lf %lf %lf %lf %lf %lf %n",
+                  &p->sourceShift.x, &p->sourceShift.y, &p->sourceShift.z,
+                  &p->detectorShift.x, &p->detectorShift.y, &p->detectorShift.z,
+                  &rotation[X], &rotation[Y], &rotation[Z], &length) != 9 || line[length] != '\0'){
+            fprintf(stderr, "Invalid perturbation at line %d of %s: %s", positionIndex + 1, path, line);
+            memset(view_perturbation, 0, sizeof(view_perturbation));
+            fclose(file);
+            return 0;
+        }
+        for(int k = 0; k < 3; k++){
+            p->detectorRotation[k] = rotation[k] * M_PI / 180;
+        }
+    }
+    fclose(file);
+    return 1;
 }
 
 /**
- * Returns the cartesian coordinates of the source.
- * 'index' is the index of the position starting from the position with the least angular distance from the y-axis.
- */
-struct point getSource(int index){
-    struct point source;
-    
-    source.z = 0;
-    source.x = -sin_table[index] * DOS;
-    source.y = cos_table[index] * DOS;
-    
-    return source;
+ * Reads the coordinates of the planes orthogonal to the y axis of a non-uniform grid from a text file.
+ * The file contains the coordinates in ascending order, separated by white spaces; n coordinates give n - 1 voxels along y.
+ * Returns 1 on success, 0 otherwise.
+ * 'path' is the path of the file.
+*/
+int readYPlanes(const char *path){
+    FILE *file = fopen(path, "r");
+    int count = 0;
+    int capacity = 1024;
+    double value;
+    if(!file){
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 0;
+    }
+    yPlaneCoordinates = (double*)malloc(sizeof(double) * capacity);
+    while(fscanf(file, "%lf", &value) == 1){
+        if(count > 0 && value <= yPlaneCoordinates[count - 1]){
+            fprintf(stderr, "The planes of %s are not in ascending order\n", path);
+            count = 0;
+            break;
+        }
+        if(count == capacity){
+            capacity *= 2;
+            yPlaneCoordinates = (double*)realloc(yPlaneCoordinates, sizeof(double) * capacity);
+        }
+        yPlaneCoordinates[count++] = value;
+    }
+    fclose(file);
+    if(count < 2){
+        fprintf(stderr, "%s must contain at least two planes\n", path);
+        free(yPlaneCoordinates);
+        yPlaneCoordinates = NULL;
+        return 0;
+    }
+    nPlanes[Y] = count;
+    return 1;
 }
 
 /**
- * Returns the cartesian coordinates of a pixel located in row 'r' and column 'c' of the detector.
- * The detector is located at index-th angular position.
- * 'r' is the row of the pixel on the detector matrix.
- * 'c' is the column of the pixel on the detector matrix.
- * 'index' is the index of the position of the detector starting from the position with the 
- * least angular distance from the y-axis.
+ * Selects the instruction set of the hot kernels from the features of the CPU: traversal and accumulation (the row
+ * kernels, selected with the grid by selectRowKernel), generation and output scaling.
+ * Returns 1 on success, 0 if the requested instruction set is unknown.
+ * 'requested' is the name of the highest instruction set to be used, NULL for the highest supported by the CPU.
 */
-struct point getPixel(int r, int c, int index){
-    struct point pixel;
-    const double sinAngle = sin_table[index];
-    const double cosAngle = cos_table[index];
-
-    pixel.x = (DOD * sinAngle) + cosAngle * (-elementOffset + PIXEL * c);
-    pixel.y = (-DOD) * cosAngle + sinAngle * (-elementOffset + PIXEL * c);
-    pixel.z = -elementOffset + PIXEL * r;
-
-    return pixel;
+int selectIsa(const char *requested){
+    int limit = N_ISAS - 1;
+    if(requested){
+        for(limit = 0; limit < N_ISAS && strcmp(isaNames[limit], requested); limit++);
+        if(limit == N_ISAS){
+            fprintf(stderr, "Unknown instruction set %s\n", requested);
+            return 0;
+        }
+    }
+    selectedIsa = ISA_DEFAULT;
+#ifdef ISA_DISPATCH
+    __builtin_cpu_init();
+    if(limit >= ISA_AVX512 && __builtin_cpu_supports("avx512f")){
+        selectedIsa = ISA_AVX512;
+    } else if(limit >= ISA_AVX2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+        selectedIsa = ISA_AVX2;
+    } else if(limit >= ISA_SSE42 && __builtin_cpu_supports("sse4.2")){
+        selectedIsa = ISA_SSE42;
+    }
+#endif
+    streamFillKernel = streamFillVariants[selectedIsa];
+    quantiseOutput = quantiseVariants[selectedIsa];
+    return 1;
 }
 
 /**
- * Returns the planes of the object's sides orthogonal to the 'x' axis.
- * 'planes' is the pointer to an array of two elements.
+ * Prints the command line usage on stderr.
  */
-void getSidesXPlanes(double *planes){
-    planes[0] = getXPlane(0);
-    planes[1] = getXPlane(nPlanes[X] - 1);
+void printUsage(const char *name){
+    fprintf(stderr,"Usage: %s [n] [0-1] [object Type] [options]\n"
+                   " n is the number of pixel per side of the detector.\n"
+                   " Second parameter must be 0 or 1, it indicates whether to rotate the detector (0) or keep it stationary (1); object type must be 1,2,3 or 4 (calibration phantom).\n"
+                   "Options:\n"
+                   " --bench             reports the time spent in each stage\n"
+                   " --trace [file]      writes the profiled regions as a Chrome trace (requires -DPROFILE)\n"
+                   " --tilt [degrees]    tilts the rotation axis towards the y axis (laminography)\n"
+                   " --layout [projection|sinogram|tiled] order of the printed projections\n"
+                   " --misalign [du] [dv] [tilt] [skew] [ds] detector shift, in-plane tilt and skew (degrees), source distance error\n"
+                   " --perturb [file]    per-position source shift, detector shift and detector rotation (degrees), one line per position\n"
+                   " --calibrate         fits the scanner alignment to projections of the calibration phantom and prints it\n"
+                   " --input [file]      reads raw projections (doubles, projection order) instead of computing them\n"
+                   " --flat [file]       flat field image used to normalise the raw projections\n"
+                   " --dark [file]       dark field image used to normalise the raw projections\n"
+                   " --outlier [ratio]   replaces raw pixels deviating from their 3x3 median by more than ratio\n"
+                   " --rings [width]     suppresses ring artifacts, width is the half width of the smoothing\n"
+                   " --tomo [slices]     prints the shift-and-add tomosynthesis reconstruction instead of the projections\n"
+                   " --tomo-range [y0] [y1] depth range of the reconstructed planes, defaults to the whole object\n"
+                   " --tomo-filter       ramp-filters the projections before the shift-and-add\n"
+                   " --tomo-fast [pixels] hierarchical backprojection, summing projections within the given transfer error\n"
+                   " --isa [default|sse4.2|avx2|avx512f] highest instruction set of the kernels, the best supported by default\n"
+                   " --voxel [x] [y] [z] sides of the voxels along each axis, 100 by default\n"
+                   " --y-planes [file]   coordinates of the planes orthogonal to the y axis of a non-uniform grid, ascending\n"
+                   " --scene [file]      projects a scene of objects instead of the single object, one line per object:\n"
+                   "                     object type, voxels per side, center (x y z) and optional rotation (x y z degrees)\n"
+                   " --window [linear|log|gamma] mapping of the values onto grey levels, linear by default\n"
+                   " --gamma [gamma]     gamma of the gamma window, 2.2 by default\n"
+                   " --format [ascii|8|16] ascii (P2, default), 8 or 16 bits binary (P5) pgm output\n"
+                   " --dither            ordered dithering of the grey levels\n"
+                   " --pyramid [prefix]  also writes the projections binned by 2x2 and 4x4 on prefix-2x2.pgm and prefix-4x4.pgm,\n"
+                   "                     in the projection layout only\n"
+                   " --ray-state         keeps the state of each ray between the sub-sections of the object\n"
+                   " --adaptive-slabs    cuts the object along the axis crossed by the fewest planes for each position\n"
+                   " --projector [siddon|shear-warp|fourier] ray tracing (default), shear-warp or Fourier slice projector,\n"
+                   "                     compared with --bench\n"
+                   " --beam [cone|parallel] cone beam from the source (default) or parallel beam along the central ray\n"
+                   " --publish [name]    computes the projections in a shared memory object (/name) or a file, with a ready flag per view,\n"
+                   "                     tracing the views one at a time\n"
+                   " --sart-cache [dir]  computes the row and column sums of the ray tracer's weights once per geometry, cached in dir\n"
+                   "Server mode:\n"
+                   " %s --serve [socket]             runs the jobs sent on the socket, one at a time\n"
+                   " %s --client [socket] [arguments] runs a job on the server and prints its images\n", name, name, name);
 }
 
+//models the options of a run; the options of the geometry are stored directly in the globals
+struct runOptions{
+    int n;
+    int objectType;
+    enum layout outputLayout;
+    const char *tracePath;
+    const char *inputPath;
+    const char *flatPath;
+    const char *darkPath;
+    const char *yPlanesPath;
+    const char *isaRequest;
+    const char *publishName;
+    const char *normalisationCache;
+    int persistentRays;
+    int adaptiveSlabs;
+    enum projector projector;
+    double outlierThreshold;
+    int ringWidth;
+    int calibrate;
+    int nTomoSlices;
+    int tomoFilter;
+    int hierarchicalTomo;
+    double tomoTolerance;
+    int tomoRange;
+    double tomoDepth[2];
+};
+
+//models a stack of images and the values mapped to black and white
+struct imageStack{
+    double *values;
+    int width;
+    int height;
+    int nImages;
+    double min;
+    double max;
+};
+
+//models a buffer kept between the runs of a server, so that it is allocated and faulted in once
+struct warmBuffer{
+    double *values;
+    size_t length;
+};
+
+//buffers of the object's sub-section, of the projections and of the printed images
+struct warmBuffer warmSlab, warmProjections, warmFiltered, warmOutput, warmRayStates, warmReference;
+
+//machine peaks of the performance model, measured by the first run in benchmark mode
+double cachedPeakFlops = 0, cachedPeakBandwidth = 0;
+
 /**
- * Returns the planes of the object's sides orthogonal to the 'y' axis.
- * 'planes' is the pointer to an array of two elements.
+ * Returns a buffer of at least 'length' values, reusing the previous allocation when it is large enough, NULL on failure.
+ * 'b' is the pointer to the buffer.
  */
-void getSidesYPlanes(double *planes, int slice){
-    planes[0] = getYPlane(slice);
-    planes[1] = getYPlane(min(nPlanes[Y] - 1, OBJ_BUFFER + slice));
+double *reserveWarmBuffer(struct warmBuffer *b, size_t length){
+    if(b->length < length){
+        free(b->values);
+        b->values = (double*)malloc(sizeof(double) * length);
+        b->length = b->values ? length : 0;
+    }
+    return b->values;
 }
 
 /**
- * Returns the planes of the object's sides orthogonal to the 'z' axis.
- * 'planes' is the pointer to an array of two elements.
+ * Frees the buffers kept between the runs.
  */
-void getSidesZPlanes(double *planes){
-    planes[0] = getZPlane(0);
-    planes[1] = getZPlane(nPlanes[Z] - 1);
+void freeWarmBuffers( void ){
+    struct warmBuffer *buffers[6] = {&warmSlab, &warmProjections, &warmFiltered, &warmOutput, &warmRayStates, &warmReference};
+    for(int k = 0; k < 6; k++){
+        free(buffers[k]->values);
+        buffers[k]->values = NULL;
+        buffers[k]->length = 0;
+    }
 }
 
 /**
- * Computes the absorption the radiological path of a ray given two points.
- * 'source' and 'pixel' are the points defining the ray.
- * 'angle' is an index that numbers the current position.
- * 'a' is an array containing the paramerter values of the intersections between the ray and voxels.
- * 'lenA' is the length of the array 'a'.
- * 'slice' is the index of the sub-section of the object.
- * 'f' is an array that stores the coefficients of the voxels cointained in the sub-section.
+ * Sets the options to their defaults and resets the globals set by the options of a previous run.
+ * 'o' is the pointer to the options.
  */
-double computeAbsorption(struct point source, struct point pixel, int angle, double *a, int lenA, int slice, double *f){
-    const double d12 = sqrt(pow(pixel.x - source.x, 2) + pow(pixel.y - source.y, 2) + pow(pixel.z - source.z, 2));
-    
-    double absorbment = 0.0;
-
-    for(int i = 0; i < lenA - 1; i ++){
-        const double segments = d12 * (a[i + 1] - a[i]);
-        const double aMid = (a[i + 1] + a[i]) / 2;
-        const int xRow = min((int)((source.x + aMid * (pixel.x - source.x) - getXPlane(0)) / VOXEL_X), nVoxel[X] - 1);
-        const int yRow = min3((int)((source.y + aMid * (pixel.y - source.y) - getYPlane(slice)) / VOXEL_Y), nVoxel[Y] - 1, OBJ_BUFFER - 1);
-        const int zRow = min((int)((source.z + aMid * (pixel.z - source.z) - getZPlane(0)) / VOXEL_Z), nVoxel[Z] - 1);
+void resetOptions(struct runOptions *o){
+    memset(o, 0, sizeof(*o));
+    o->n = 2352;
+    o->outputLayout = PROJECTION;
 
-        absorbment += f[(yRow) * nVoxel[X] * nVoxel[Z] + zRow * nVoxel[Z] + xRow] * segments;
-    }
-    return absorbment;
+    benchmark = 0;
+    tiltAngle = 0;
+    stationaryDetector = 0;
+    memset(&scannerAlignment, 0, sizeof(scannerAlignment));
+    memset(view_perturbation, 0, sizeof(view_perturbation));
+    VOXEL_X = VOXEL_Y = VOXEL_Z = 100;
+    outputWindow = LINEAR_WINDOW;
+    outputGamma = 2.2;
+    outputFormat = ASCII_PIXELS;
+    outputDither = 0;
+    pyramidPrefix = NULL;
+    parallelBeam = 0;
+    free(yPlaneCoordinates);
+    yPlaneCoordinates = NULL;
+    freeScene();
+    nSceneObjects = 0;
+    traversalRays = traversalIntersections = traversalSegments = 0;
 }
 
-
 /**
- * Computes the projection of a sub-section of the object onto the detector for each source position.
- * 'slice' is the index of the sub-section of the object.
- * 'f' is an array stores the coefficients of the voxels cointained in the sub-section.
- * 'absorbment' is the resulting array, contains the value of absorbtion for each pixel.
- * 'absMax' is the maximum absorbtion computed.
- * 'absMax' is the minimum absorbtion computed.
+ * Parses the command line of a run.
+ * Returns 1 on success, 0 otherwise.
+ * 'argc' and 'argv' are the arguments, the first one being the name of the program.
+ * 'o' is the pointer to the options, set to their defaults by resetOptions.
 */
-void computeProjections(int slice, double *f, double *absorbment, double *absMax, double *absMin){
-    const int nTheta = (int)(AP / STEP_ANGLE);                      //number of angular position
-    double amax = -INFINITY;
-    double amin = INFINITY;
-    double temp[3][2];
-    double aMerged[nPlanes[X] + nPlanes[X] + nPlanes[X]];
-    double aX[nPlanes[X]];
-    double aY[nPlanes[Y]];
-    double aZ[nPlanes[Z]];
-
-    //iterates over each source
-    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
-        const struct point source = getSource(positionIndex);
-
-        //iterates over each pixel of the detector 
-#pragma omp parallel for collapse(2) schedule(dynamic) default(none) shared(nSidePixels, positionIndex, source, slice, f, absorbment, stationaryDetector, nTheta, nVoxel) private(temp, aX, aY, aZ, aMerged) reduction(min:amin) reduction(max:amax)
-        for(int r = 0; r < nSidePixels; r++){
-            for(int c = 0; c < nSidePixels; c++){
-                struct point pixel;
-
-                //gets the pixel position based on whether the detector rotates or not
-                if(stationaryDetector){
-                    pixel = getPixel(r,c, nTheta / 2);
-                } else {
-                    pixel = getPixel(r,c,positionIndex);
-                }
-
-                //computes Min-Max parametric values
-                double aMin, aMax;
-                double sidesPlanes[2];
-                int isParallel = -1;
-                getSidesXPlanes(sidesPlanes);
-                if(!getIntersection(source.x, pixel.x, sidesPlanes, 2, &temp[X][0])){
-                    isParallel = X;
-                }
-                getSidesYPlanes(sidesPlanes, slice);
-                if(!getIntersection(source.y, pixel.y, sidesPlanes, 2, &temp[Y][0])){
-                    isParallel = Y;
-                }
-                getSidesZPlanes(sidesPlanes);
-                if(!getIntersection(source.z, pixel.z, sidesPlanes, 2, &temp[Z][0])){
-                    isParallel = Z;
-                }
-
-                aMin = getAMin(temp, isParallel);
-                aMax = getAMax(temp, isParallel);
-
-                if(aMin < aMax){
-                    //computes Min-Max plane indexes 
-                    struct ranges indeces[3];
-                    indeces[X] = getRangeOfIndex(source.x, pixel.x, isParallel, aMin, aMax, X);
-                    indeces[Y] = getRangeOfIndex(source.y, pixel.y, isParallel, aMin, aMax, Y);
-                    indeces[Z] = getRangeOfIndex(source.z, pixel.z, isParallel, aMin, aMax, Z);
-
-                    //computes lenghts of the arrays containing parametric value of the intersection with each set of parallel planes
-                    int lenX = indeces[X].maxIndx - indeces[X].minIndx;
-                    int lenY = indeces[Y].maxIndx - indeces[Y].minIndx;
-                    int lenZ = indeces[Z].maxIndx - indeces[Z].minIndx;
-                    if(lenX < 0){
-                        lenX = 0;
-                    }
-                    if(lenY < 0){
-                        lenY = 0;
-                    }
-                    if(lenZ < 0){
-                        lenZ = 0;
-                    }
-                    const int lenA = lenX + lenY + lenZ;
-
-                    //computes ray-planes intersection Nx + Ny + Nz
-                    getAllIntersections(source.x, pixel.x, indeces[X], aX, X);
-                    getAllIntersections(source.y, pixel.y, indeces[Y], aY, Y);
-                    getAllIntersections(source.z, pixel.z, indeces[Z], aZ, Z);
-
-                    //computes segments Nx + Ny + Nz
-                    merge3(aX, aY, aZ, lenX, lenY, lenZ, aMerged);
-
-                    //associates each segment to the respective voxel Nx + Ny + Nz
-                    const int pixelIndex = positionIndex * nSidePixels * nSidePixels + r *nSidePixels + c;
-                    absorbment[pixelIndex] += computeAbsorption(source, pixel, positionIndex, aMerged, lenA, slice, f);
-                    amax = fmax(amax, absorbment[pixelIndex]);
-                    amin = fmin(amin, absorbment[pixelIndex]);
-
-                }
+int parseOptions(int argc, char *argv[], struct runOptions *o){
+    int nPositional = 0;
+    for(int i = 1; i < argc; i++){
+        const int outputOption = parseOutputOption(argc, argv, &i);
+        if(outputOption > 0){
+            continue;
+        } else if(outputOption < 0){
+            printUsage(argv[0]);
+            return 0;
+        } else if(!strcmp(argv[i], "--bench")){
+            benchmark = 1;
+        } else if(!strcmp(argv[i], "--trace") && i + 1 < argc){
+            o->tracePath = argv[++i];
+        } else if(!strcmp(argv[i], "--tilt") && i + 1 < argc){
+            tiltAngle = atof(argv[++i]);
+        } else if(!strcmp(argv[i], "--layout") && i + 1 < argc){
+            i++;
+            if(!strcmp(argv[i], "projection")){
+                o->outputLayout = PROJECTION;
+            } else if(!strcmp(argv[i], "sinogram")){
+                o->outputLayout = SINOGRAM;
+            } else if(!strcmp(argv[i], "tiled")){
+                o->outputLayout = TILED;
+            } else {
+                printUsage(argv[0]);
+                return 0;
+            }
+        } else if(!strcmp(argv[i], "--misalign") && i + 5 < argc){
+            scannerAlignment.offsetU = atof(argv[++i]);
+            scannerAlignment.offsetV = atof(argv[++i]);
+            scannerAlignment.tilt = atof(argv[++i]) * M_PI / 180;
+            scannerAlignment.skew = atof(argv[++i]) * M_PI / 180;
+            scannerAlignment.sourceDistance = atof(argv[++i]);
+        } else if(!strcmp(argv[i], "--perturb") && i + 1 < argc){
+            if(!readPerturbations(argv[++i]))
+                return 0;
+        } else if(!strcmp(argv[i], "--calibrate")){
+            o->calibrate = 1;
+        } else if(!strcmp(argv[i], "--input") && i + 1 < argc){
+            o->inputPath = argv[++i];
+        } else if(!strcmp(argv[i], "--flat") && i + 1 < argc){
+            o->flatPath = argv[++i];
+        } else if(!strcmp(argv[i], "--dark") && i + 1 < argc){
+            o->darkPath = argv[++i];
+        } else if(!strcmp(argv[i], "--outlier") && i + 1 < argc){
+            o->outlierThreshold = atof(argv[++i]);
+        } else if(!strcmp(argv[i], "--rings") && i + 1 < argc){
+            o->ringWidth = atoi(argv[++i]);
+        } else if(!strcmp(argv[i], "--tomo") && i + 1 < argc){
+            o->nTomoSlices = atoi(argv[++i]);
+        } else if(!strcmp(argv[i], "--tomo-range") && i + 2 < argc){
+            o->tomoRange = 1;
+            o->tomoDepth[0] = atof(argv[++i]);
+            o->tomoDepth[1] = atof(argv[++i]);
+        } else if(!strcmp(argv[i], "--tomo-filter")){
+            o->tomoFilter = 1;
+        } else if(!strcmp(argv[i], "--tomo-fast") && i + 1 < argc){
+            o->hierarchicalTomo = 1;
+            o->tomoTolerance = atof(argv[++i]);
+        } else if(!strcmp(argv[i], "--isa") && i + 1 < argc){
+            o->isaRequest = argv[++i];
+        } else if(!strcmp(argv[i], "--publish") && i + 1 < argc){
+            o->publishName = argv[++i];
+        } else if(!strcmp(argv[i], "--sart-cache") && i + 1 < argc){
+            o->normalisationCache = argv[++i];
+        } else if(!strcmp(argv[i], "--ray-state")){
+            o->persistentRays = 1;
+        } else if(!strcmp(argv[i], "--adaptive-slabs")){
+            o->adaptiveSlabs = 1;
+        } else if(!strcmp(argv[i], "--projector") && i + 1 < argc){
+            i++;
+            if(!strcmp(argv[i], "siddon")){
+                o->projector = SIDDON_PROJECTOR;
+            } else if(!strcmp(argv[i], "shear-warp")){
+                o->projector = SHEAR_WARP_PROJECTOR;
+            } else if(!strcmp(argv[i], "fourier")){
+                o->projector = FOURIER_PROJECTOR;
+            } else {
+                printUsage(argv[0]);
+                return 0;
+            }
+            //the Fourier slice theorem holds for parallel projections
+            if(o->projector == FOURIER_PROJECTOR)
+                parallelBeam = 1;
+        } else if(!strcmp(argv[i], "--beam") && i + 1 < argc){
+            i++;
+            if(strcmp(argv[i], "cone") && strcmp(argv[i], "parallel")){
+                printUsage(argv[0]);
+                return 0;
+            }
+            parallelBeam = !strcmp(argv[i], "parallel");
+        } else if(!strcmp(argv[i], "--voxel") && i + 3 < argc){
+            VOXEL_X = atoi(argv[++i]);
+            VOXEL_Y = atoi(argv[++i]);
+            VOXEL_Z = atoi(argv[++i]);
+            if(VOXEL_X <= 0 || VOXEL_Y <= 0 || VOXEL_Z <= 0){
+                printUsage(argv[0]);
+                return 0;
+            }
+        } else if(!strcmp(argv[i], "--y-planes") && i + 1 < argc){
+            o->yPlanesPath = argv[++i];
+        } else if(!strcmp(argv[i], "--scene") && i + 1 < argc){
+            if(!readScene(argv[++i]))
+                return 0;
+        } else if(argv[i][0] == '-' && argv[i][1] == '-'){
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            switch(nPositional++){
+                case 0:
+                    o->n = atoi(argv[i]);
+                    break;
+                case 1:
+                    stationaryDetector = atoi(argv[i]);
+                    break;
+                case 2:
+                    o->objectType = atoi(argv[i]);
+                    break;
+                default:
+                    printUsage(argv[0]);
+                    return 0;
             }
         }
-        // fprintf(stderr,"Time[%d]: %lf\n",angle, omp_get_wtime() - time);
     }
-    *absMax = amax;
-    *absMin = amin;
-}
-
-int main(int argc, char *argv[])
-{
-
-
-    int n = 2352;
-    int objectType = 0;
-    if(argc > 4){
-        fprintf(stderr,"Usage: %s [0-1] [object Type]\n First parameter must be 0 or 1, it indicates whether to rotate the detector (0) or keep it stationary (1); object type must be 1,2 or 3.",argv[0]);
-        return EXIT_FAILURE;
+    //the other stages model the cone beam
+    if(parallelBeam && (nSceneObjects > 0 || o->projector == SHEAR_WARP_PROJECTOR || o->nTomoSlices > 0 || o->calibrate)){
+        fprintf(stderr,"The parallel beam is not available to scenes, tomosynthesis, calibration and the shear-warp projector\n");
+        return 0;
     }
-    if(argc > 1){
-        n = atoi(argv[1]);
+    if(o->projector == FOURIER_PROJECTOR && !parallelBeam){
+        fprintf(stderr,"The Fourier projector requires a parallel beam\n");
+        return 0;
     }
-    if(argc > 2){
-        stationaryDetector = atoi(argv[2]);
+    //the objects of a scene have their own grids
+    if(o->normalisationCache && nSceneObjects > 0){
+        fprintf(stderr,"The SART normalisation is not available to scenes\n");
+        return 0;
     }
-    if(argc > 3){
-        objectType = atoi(argv[3]);
+    //the levels are binned from the printed images, which are the projections only in the projection layout
+    if(pyramidPrefix && (o->outputLayout != PROJECTION || o->nTomoSlices > 0)){
+        fprintf(stderr,"The pyramid is only available to the projections, in the projection layout\n");
+        return 0;
     }
+    return 1;
+}
 
-    VOXEL_MAT = n * VOXEL_X * 125 / 294;
-    DETECTOR = n * PIXEL;
+/**
+ * Computes the geometry of a run from its options, and selects the kernels.
+ * Returns 1 on success, 0 otherwise.
+ * 'o' is the pointer to the options.
+ */
+int setupGeometry(const struct runOptions *o){
+    VOXEL_MAT = o->n * VOXEL_X * 125 / 294;
+    DETECTOR = o->n * PIXEL;
     DOD = 1.5 * VOXEL_MAT;
     DOS = 6 * VOXEL_MAT;
 
@@ -636,59 +5110,625 @@ int main(int argc, char *argv[])
     nPlanes[Y] = (VOXEL_MAT / VOXEL_Y) + 1;
     nPlanes[Z] = (VOXEL_MAT / VOXEL_Z) + 1;
 
+    //a non-uniform grid replaces the y planes of the uniform one
+    if(o->yPlanesPath){
+        if(!readYPlanes(o->yPlanesPath))
+            return 0;
+        nVoxel[Y] = nPlanes[Y] - 1;
+    }
+
     elementOffset = DETECTOR / 2 - PIXEL / 2;
 
     nSidePixels = DETECTOR / PIXEL;
 
+    //the projections are written directly in the requested order unless a later stage needs them in projection order
+    projectionLayout = o->nTomoSlices > 0 || o->inputPath ? PROJECTION : o->outputLayout;
+
+    init_tables();
+    chooseSlabAxes(o->adaptiveSlabs);
+    if(o->adaptiveSlabs){
+        fprintf(stderr,"Slab axes:");
+        for(int positionIndex = 0; positionIndex <= (int)(AP / STEP_ANGLE); positionIndex++){
+            fprintf(stderr," %c", "xyz"[view_slabAxis[positionIndex]]);
+        }
+        fprintf(stderr,"\n");
+    }
+    if(!selectIsa(o->isaRequest))
+        return 0;
+    selectRowKernel();
+    fprintf(stderr,"Kernels: %s instruction set, %s row kernel\n", isaNames[selectedIsa], rowKernelName);
+    return 1;
+}
+
+/**
+ * Computes (or reads) the projections of a run and the images to be printed: the projections in the requested layout,
+ * or the tomosynthesis slices; the fitted alignment of a calibration is printed instead.
+ * The buffers are kept between the runs, the images point into them.
+ * Returns 1 on success, 0 otherwise.
+ * 'o' is the pointer to the options.
+ * 'result' is the pointer to the images, their values are NULL after a calibration.
+*/
+int runProjector(const struct runOptions *o, struct imageStack *result){
     //number of angular positions
     const int nTheta = (int)(AP / STEP_ANGLE);
-    //array containing the coefficents of each voxel
-    double *f = (double*)malloc(sizeof(double) * nVoxel[X] * nVoxel[Z] * OBJ_BUFFER);
-    //array containing the computed absorption detected in each pixel of the detector
-    double *absorbment = (double*)calloc(nSidePixels * nSidePixels * (nTheta + 1), sizeof(double));
+    const size_t nProjectionValues = (size_t)nSidePixels * nSidePixels * (nTheta + 1);
+    //array containing the coefficents of each voxel, large enough for a sub-section cut along any of the chosen axes
+    size_t slabLength = 0;
+    for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+        for(int ax = 0; ax < 3; ax++){
+            //the shear-warp projector cuts the object along the principal axis of each position, the weights along y
+            const size_t axisSlabLength = (size_t)OBJ_BUFFER * nVoxel[(ax + 1) % 3] * nVoxel[(ax + 2) % 3];
+            if((ax == (int)view_slabAxis[positionIndex] || o->projector == SHEAR_WARP_PROJECTOR || (ax == Y && o->normalisationCache))
+               && axisSlabLength > slabLength)
+                slabLength = axisSlabLength;
+        }
+    }
+    double *f = reserveWarmBuffer(&warmSlab, slabLength);
+    //array containing the computed absorption detected in each pixel of the detector, computed in place when published
+    double *absorbment = o->publishName ? openPublication(o->publishName, nTheta + 1) : reserveWarmBuffer(&warmProjections, nProjectionValues);
     //each thread has its own variable to store its minimum and maximum absorption computed
     double absMaxValue, absMinValue;
 
+    if(!f || !absorbment){
+        fprintf(stderr,"Cannot allocate the projections\n");
+        return 0;
+    }
+    if(!publication)
+        memset(absorbment, 0, sizeof(double) * nProjectionValues);
+    result->values = NULL;
+    //the state of the rays is set by the first sub-section
+    rayStates = o->persistentRays ? reserveWarmBuffer(&warmRayStates, 2 * nProjectionValues) : NULL;
+    if(o->persistentRays && !rayStates){
+        fprintf(stderr,"Cannot allocate the state of the rays\n");
+        return 0;
+    }
+    //the weights are accumulated in the sub-section's buffer, before the object is generated in it
+    if(o->normalisationCache && !cacheNormalisation(o->normalisationCache, f))
+        return 0;
+
+#ifdef PROFILE
+    if(o->tracePath)
+        initTrace();
+#else
+    if(o->tracePath)
+        fprintf(stderr,"Profiling is disabled, compile with -DPROFILE to write %s\n", o->tracePath);
+#endif
+
+    double generationTime = 0;
+    size_t generatedBytes = 0;
+    double tracedRays = 0;
+    double projectionTime = 0;
+
+    if(benchmark && !openCounters()){
+        fprintf(stderr,"Hardware counters are not available\n");
+    }
+    //the machine peaks are measured once, before any work, for the performance model
+    if(benchmark && cachedPeakFlops == 0){
+        measurePeaks(&cachedPeakFlops, &cachedPeakBandwidth);
+    }
 
-    init_tables();
-    
     double totalTime = omp_get_wtime();
 
-    //iterates over object subsection
-    for(int slice = 0; slice < nVoxel[Y]; slice += OBJ_BUFFER){
-        //generate object subsection
-        switch (objectType){
-            case 1:
-                generateCubeWithSphereSlice(f, OBJ_BUFFER, slice, nVoxel[X]);
-                break;
-            case 2:
-                generateSphereSlice(f, OBJ_BUFFER, slice, VOXEL_MAT / 2);
-                break;
-            default:
-                generateCubeSlice(f, OBJ_BUFFER, slice, nVoxel[X]);
-                break;
+    if(o->inputPath){
+        //raw projections are streamed from the file and converted a projection at a time
+        if(!preprocessProjections(o->inputPath, o->flatPath, o->darkPath, o->outlierThreshold, o->ringWidth, absorbment))
+            return 0;
+        getMinMax(absorbment, nProjectionValues, &absMinValue, &absMaxValue);
+    }
+
+    if(!o->inputPath && nSceneObjects > 0){
+        //each object of the scene is generated whole in its own grid, then the scene is projected in a single pass
+        double generationStart = omp_get_wtime();
+        PROFILE_BEGIN(generationRegion);
+        startCounters();
+        for(int k = 0; k < nSceneObjects; k++){
+            if(!generateSceneObject(&sceneObjects[k])){
+                fprintf(stderr,"Cannot allocate object %d of the scene\n", k);
+                return 0;
+            }
+            generatedBytes += sizeof(double) * sceneObjects[k].side * sceneObjects[k].side * sceneObjects[k].side;
+        }
+        buildSceneHierarchy();
+        stopCounters(STAGE_GENERATION);
+        PROFILE_END(STAGE_GENERATION, generationRegion);
+        generationTime += omp_get_wtime() - generationStart;
+
+        double projectionStart = omp_get_wtime();
+        startCounters();
+        computeSceneProjections(absorbment, &absMaxValue, &absMinValue);
+        stopCounters(STAGE_VIEW);
+        projectionTime += omp_get_wtime() - projectionStart;
+        tracedRays += (double)nSidePixels * nSidePixels * (nTheta + 1);
+    }
+
+    //the shear-warp and Fourier projectors replace the ray tracer, which then only runs in benchmark mode as their reference
+    const int fast = !o->inputPath && nSceneObjects == 0 && o->projector != SIDDON_PROJECTOR;
+    const int tracing = !o->inputPath && nSceneObjects == 0 && (!fast || benchmark);
+    struct publicationHeader *published = publication;
+    double *traced = absorbment;
+    double tracingTime = omp_get_wtime();
+    if(fast && benchmark){
+        traced = reserveWarmBuffer(&warmReference, nProjectionValues);
+        if(!traced){
+            fprintf(stderr,"Cannot allocate the reference projections\n");
+            return 0;
+        }
+        memset(traced, 0, sizeof(double) * nProjectionValues);
+        //the views of the reference are not published
+        publication = NULL;
+    }
+
+    //the positions are traced in groups sharing the axis along which the object is cut, each group on its own sub-sections
+    const enum axis groupAxes[3] = {Y, X, Z};
+    if(tracing){
+        absMaxValue = -INFINITY;
+        absMinValue = INFINITY;
+    }
+    for(int group = 0; tracing && group < 3; group++){
+        int nGroupViews = 0;
+        for(int positionIndex = 0; positionIndex <= nTheta; positionIndex++){
+            nGroupViews += view_slabAxis[positionIndex] == groupAxes[group];
+        }
+        if(nGroupViews == 0)
+            continue;
+        slabAxis = groupAxes[group];
+        const struct objectGrid grid = getObjectGrid();
+        //published views are traced one at a time on all the sub-sections, so that each one is ready as soon as possible,
+        //at the cost of generating the sub-sections again for each view
+        const int viewMajor = publication && nVoxel[slabAxis] > OBJ_BUFFER;
+
+        for(int pass = 0; pass <= (viewMajor ? nTheta : 0); pass++){
+            const int view = viewMajor ? pass : -1;
+            if(viewMajor && view_slabAxis[view] != slabAxis)
+                continue;
+            //iterates over object subsection
+            for(int slice = 0; slice < nVoxel[slabAxis]; slice += OBJ_BUFFER){
+                double sliceMax, sliceMin;
+                //generate object subsection
+                double generationStart = omp_get_wtime();
+                PROFILE_BEGIN(generationRegion);
+                startCounters();
+                generateSlab(&grid, f, OBJ_BUFFER, slice, o->objectType, slabAxis);
+                stopCounters(STAGE_GENERATION);
+                PROFILE_END(STAGE_GENERATION, generationRegion);
+                generationTime += omp_get_wtime() - generationStart;
+                generatedBytes += sizeof(double) * slabLength;
+
+                //computes subsection projection
+                double projectionStart = omp_get_wtime();
+                startCounters();
+                swapSlabAxis(slabAxis);
+                computeProjections(slice, view, f, traced, &sliceMax, &sliceMin);
+                swapSlabAxis(slabAxis);
+                stopCounters(STAGE_VIEW);
+                projectionTime += omp_get_wtime() - projectionStart;
+                tracedRays += (double)nSidePixels * nSidePixels * (view >= 0 ? 1 : nGroupViews);
+
+                //the range of absorption is the one of the last sub-section of each group
+                if(slice + OBJ_BUFFER >= nVoxel[slabAxis]){
+                    absMaxValue = fmax(absMaxValue, sliceMax);
+                    absMinValue = fmin(absMinValue, sliceMin);
+                }
+            }
         }
+    }
+    slabAxis = Y;
+    tracingTime = omp_get_wtime() - tracingTime;
+    publication = published;
 
-        //computes subsection projection
-        computeProjections(slice, f, absorbment, &absMaxValue, &absMinValue);
+    if(fast){
+        const int shearWarp = o->projector == SHEAR_WARP_PROJECTOR;
+        double fastTime = omp_get_wtime();
+        startCounters();
+        if(shearWarp ? !computeShearWarpProjections(o->objectType, f, absorbment, &absMaxValue, &absMinValue)
+                     : !computeFourierProjections(o->objectType, f, absorbment, &absMaxValue, &absMinValue))
+            return 0;
+        stopCounters(STAGE_VIEW);
+        fastTime = omp_get_wtime() - fastTime;
+        if(benchmark)
+            reportApproximationError(shearWarp ? "Shear-warp" : "Fourier", "ray tracing", absorbment, traced, nProjectionValues, fastTime, tracingTime);
     }
     fprintf(stderr,"Execution time: %lf\n", omp_get_wtime() - totalTime);
+    if(benchmark && generationTime > 0){
+        fprintf(stderr,"Generation time: %lf (%.2lf GB/s)\n", generationTime, generatedBytes / generationTime * 1e-9);
+    }
+    if(benchmark && projectionTime > 0 && traversalSegments > 0){
+        reportRoofline(projectionTime, cachedPeakFlops, cachedPeakBandwidth);
+    }
+    if(counters){
+        fprintf(stderr,"Generation counters:\n");
+        reportCounters(STAGE_GENERATION, 0);
+        fprintf(stderr,"Projection counters:\n");
+        reportCounters(STAGE_VIEW, tracedRays);
+    }
     fflush(stderr);
+    completePublication(absMinValue, absMaxValue);
 
-    //iterates over each absorption value computed, prints a value between [0-255]
-    printf("P2\n%d %d\n255", nSidePixels, nSidePixels * (nTheta + 1));
-    for(double positionIndex = 0; positionIndex <= nTheta; positionIndex ++){
-        for(int i = 0; i < nSidePixels; i++ ){
-            printf("\n");
-            for(int j = 0; j < nSidePixels; j++ ){
-                int pixelIndex = positionIndex * nSidePixels * nSidePixels + i *nSidePixels + j;
-                int color =  (absorbment[pixelIndex] - absMinValue) * 255 / (absMaxValue - absMinValue);
-                printf("%d ", color);
+    if(o->calibrate){
+        struct alignment fitted;
+        double calibrationTime = omp_get_wtime();
+        const double rms = calibrateGeometry(absorbment, &fitted);
+        fprintf(stderr,"Calibration time: %lf\n", omp_get_wtime() - calibrationTime);
+        printf("offsetU %lf\noffsetV %lf\ntilt %lf\nskew %lf\nsourceDistance %lf\nrms %lf\n",
+               fitted.offsetU, fitted.offsetV, fitted.tilt * 180 / M_PI, fitted.skew * 180 / M_PI, fitted.sourceDistance, rms);
+    } else if(o->nTomoSlices > 0){
+        //reconstructs planes evenly spaced along the y axis
+        const int nTomoSlices = o->nTomoSlices;
+        double *depths = (double*)malloc(sizeof(double) * nTomoSlices);
+        double *slices = reserveWarmBuffer(&warmOutput, (size_t)nTomoSlices * nVoxel[X] * nVoxel[Z]);
+        double *views = absorbment;
+        double tomoDepth[2] = {o->tomoDepth[0], o->tomoDepth[1]};
+        if(!o->tomoRange){
+            tomoDepth[0] = getYPlane(0);
+            tomoDepth[1] = getYPlane(nPlanes[Y] - 1);
+        }
+        for(int s = 0; s < nTomoSlices; s++){
+            depths[s] = tomoDepth[0] + (s + 0.5) * (tomoDepth[1] - tomoDepth[0]) / nTomoSlices;
+        }
+
+        double tomoTime = omp_get_wtime();
+        if(o->tomoFilter){
+            views = reserveWarmBuffer(&warmFiltered, nProjectionValues);
+            rampFilterProjections(absorbment, views, nTheta + 1);
+        }
+        if(o->hierarchicalTomo){
+            if(!reconstructHierarchical(views, depths, nTomoSlices, o->tomoTolerance, slices)){
+                free(depths);
+                return 0;
+            }
+        } else {
+            reconstructTomosynthesis(views, depths, nTomoSlices, slices);
+        }
+        tomoTime = omp_get_wtime() - tomoTime;
+        fprintf(stderr,"Tomosynthesis time: %lf\n", tomoTime);
+        //the shift-and-add reconstruction is the reference of the hierarchical one
+        double *reference = o->hierarchicalTomo && benchmark ? reserveWarmBuffer(&warmReference, (size_t)nTomoSlices * nVoxel[X] * nVoxel[Z]) : NULL;
+        if(reference){
+            double referenceTime = omp_get_wtime();
+            reconstructTomosynthesis(views, depths, nTomoSlices, reference);
+            referenceTime = omp_get_wtime() - referenceTime;
+            reportApproximationError("Hierarchical backprojection", "shift-and-add", slices, reference, (size_t)nTomoSlices * nVoxel[X] * nVoxel[Z], tomoTime, referenceTime);
+        }
+
+        result->values = slices;
+        result->width = nVoxel[X];
+        result->height = nVoxel[Z];
+        result->nImages = nTomoSlices;
+        getMinMax(slices, (size_t)nTomoSlices * nVoxel[X] * nVoxel[Z], &result->min, &result->max);
+        free(depths);
+    } else {
+        PROFILE_BEGIN(outputStart);
+        startCounters();
+        result->values = absorbment;
+        if(projectionLayout != o->outputLayout){
+            result->values = reserveWarmBuffer(&warmOutput, nProjectionValues);
+            convertLayout(absorbment, projectionLayout, result->values, o->outputLayout);
+        }
+        stopCounters(STAGE_OUTPUT);
+        PROFILE_END(STAGE_OUTPUT, outputStart);
+
+        result->width = nSidePixels;
+        result->height = o->outputLayout == SINOGRAM ? nTheta + 1 : nSidePixels;
+        result->nImages = o->outputLayout == SINOGRAM ? nSidePixels : nTheta + 1;
+        result->min = absMinValue;
+        result->max = absMaxValue;
+    }
+    return 1;
+}
+
+#ifdef __linux__
+//models a job queued by the server: the connection of the client and the arguments of the run
+struct serverJob{
+    int client;
+    char *request;
+    int argc;
+    char *argv[SERVER_MAX_ARGS];
+};
+
+//models the header of the shared memory segment holding the images of a job, followed by their values
+struct resultHeader{
+    int32_t width;
+    int32_t height;
+    int32_t nImages;
+    int32_t padding;
+    double min;
+    double max;
+};
+
+//models the reply of the server to a job: 0 on success, and the name of the shared memory segment holding the images
+struct jobReply{
+    int32_t status;
+    char segment[64];
+};
+
+/**
+ * Reads or writes exactly 'length' bytes on a socket.
+ * Returns 1 on success, 0 otherwise.
+ * 'write' is 1 to write, 0 to read.
+ */
+int transferFully(int socket, void *buffer, size_t length, int write){
+    char *p = (char*)buffer;
+    while(length > 0){
+        const ssize_t done = write ? send(socket, p, length, MSG_NOSIGNAL) : recv(socket, p, length, 0);
+        if(done <= 0)
+            return 0;
+        p += done;
+        length -= done;
+    }
+    return 1;
+}
+
+/**
+ * Reads a job from a client: the length of the request followed by the arguments, each terminated by a null character.
+ * Returns 1 on success, 0 otherwise.
+ * 'job' is the pointer to the job, 'job->client' is the connection of the client.
+ */
+int readJob(struct serverJob *job){
+    uint32_t length;
+    if(!transferFully(job->client, &length, sizeof(length), 0) || length == 0 || length > SERVER_MAX_REQUEST)
+        return 0;
+    job->request = (char*)malloc(length + 1);
+    if(!job->request || !transferFully(job->client, job->request, length, 0)){
+        free(job->request);
+        return 0;
+    }
+    job->request[length] = '\0';
+    job->argc = 0;
+    for(size_t k = 0; k < length && job->argc < SERVER_MAX_ARGS; k += strlen(job->request + k) + 1){
+        job->argv[job->argc++] = job->request + k;
+    }
+    return 1;
+}
+
+/**
+ * Publishes images in a new shared memory segment: a resultHeader followed by the values.
+ * Returns 1 on success, 0 otherwise.
+ * 'images' is the pointer to the images.
+ * 'name' is the name of the segment.
+ */
+int publishImages(const struct imageStack *images, const char *name){
+    const size_t length = (size_t)images->width * images->height * images->nImages;
+    const size_t size = sizeof(struct resultHeader) + sizeof(double) * length;
+    const int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(fd < 0){
+        perror(name);
+        return 0;
+    }
+    void *segment = ftruncate(fd, size) ? MAP_FAILED : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(segment == MAP_FAILED){
+        perror(name);
+        shm_unlink(name);
+        return 0;
+    }
+    struct resultHeader *header = (struct resultHeader*)segment;
+    header->width = images->width;
+    header->height = images->height;
+    header->nImages = images->nImages;
+    header->padding = 0;
+    header->min = images->min;
+    header->max = images->max;
+    memcpy(header + 1, images->values, sizeof(double) * length);
+    munmap(segment, size);
+    return 1;
+}
+
+/**
+ * Runs a job of the server and publishes its images.
+ * Returns 1 on success, 0 otherwise.
+ * 'job' is the pointer to the job.
+ * 'segment' is the name of the shared memory segment on which to publish the images.
+ */
+int runServerJob(struct serverJob *job, const char *segment){
+    struct runOptions o;
+    struct imageStack images;
+    int done;
+
+    resetOptions(&o);
+    if(!parseOptions(job->argc, job->argv, &o) || !setupGeometry(&o))
+        return 0;
+    if(o.calibrate || o.tracePath){
+        fprintf(stderr,"--calibrate and --trace are not available to the jobs of a server\n");
+        return 0;
+    }
+    done = runProjector(&o, &images) && publishImages(&images, segment);
+    closePublication();
+    closeCounters();
+    return done;
+}
+
+/**
+ * Serves projection jobs on a Unix domain socket until a client asks to shut down.
+ * The pending jobs are queued as soon as the running job ends, and run in order on the shared OpenMP threads; the buffers,
+ * the kernels and the machine peaks stay warm between the jobs. The images of each job are published in a shared memory
+ * segment, which the client unlinks once read.
+ * Returns the exit status of the server.
+ * 'socketPath' is the path of the socket.
+ */
+int serve(const char *socketPath){
+    struct sockaddr_un address;
+    struct serverJob queue[SERVER_QUEUE];
+    int head = 0, count = 0, jobIndex = 0, running = 1;
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+    unlink(socketPath);
+    if(listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) || listen(listener, SERVER_QUEUE)){
+        perror(socketPath);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr,"Serving on %s\n", socketPath);
+
+    while(running){
+        //queues the pending jobs, waits for a job only if none is queued
+        struct pollfd pending = {listener, POLLIN, 0};
+        while(count < SERVER_QUEUE && poll(&pending, 1, count > 0 ? 0 : -1) > 0){
+            struct serverJob *job = &queue[(head + count) % SERVER_QUEUE];
+            job->client = accept(listener, NULL, NULL);
+            if(job->client < 0)
+                break;
+            //a client that does not send its job is dropped, so that it does not stall the server
+            const struct timeval timeout = {SERVER_RECEIVE_TIMEOUT, 0};
+            if(!setsockopt(job->client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) && readJob(job)){
+                count++;
+            } else {
+                close(job->client);
             }
         }
+        if(count == 0)
+            continue;
+
+        struct serverJob *job = &queue[head];
+        struct jobReply reply;
+        head = (head + 1) % SERVER_QUEUE;
+        count--;
+        memset(&reply, 0, sizeof(reply));
+        if(job->argc > 1 && !strcmp(job->argv[1], "--shutdown")){
+            running = 0;
+        } else {
+            snprintf(reply.segment, sizeof(reply.segment), "/projector-%d-%d", (int)getpid(), jobIndex++);
+            reply.status = !runServerJob(job, reply.segment);
+            fflush(stderr);
+        }
+        transferFully(job->client, &reply, sizeof(reply), 1);
+        close(job->client);
+        free(job->request);
+    }
+
+    //the jobs queued behind the shutdown are refused
+    for(; count > 0; count--, head = (head + 1) % SERVER_QUEUE){
+        close(queue[head].client);
+        free(queue[head].request);
+    }
+    close(listener);
+    unlink(socketPath);
+    resetOptions(&(struct runOptions){0});
+    freeWarmBuffers();
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Sends a job to a server and prints its images as a pgm image, read from the shared memory segment.
+ * Returns the exit status of the client.
+ * 'socketPath' is the path of the server's socket.
+ * 'argc' and 'argv' are the arguments of the job, the first one being the name of the program.
+ */
+int runClient(const char *socketPath, int argc, char *argv[]){
+    struct sockaddr_un address;
+    struct jobReply reply;
+    char request[SERVER_MAX_REQUEST];
+    uint32_t length = 0;
+    const int server = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    //the images are printed by the client, the server ignores the options of the output
+    for(int i = 1; i < argc; i++){
+        if(parseOutputOption(argc, argv, &i) < 0){
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    for(int i = 0; i < argc; i++){
+        const size_t size = strlen(argv[i]) + 1;
+        if(length + size > SERVER_MAX_REQUEST){
+            fprintf(stderr,"The job is too long\n");
+            return EXIT_FAILURE;
+        }
+        memcpy(request + length, argv[i], size);
+        length += size;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+    if(server < 0 || connect(server, (struct sockaddr*)&address, sizeof(address))){
+        perror(socketPath);
+        return EXIT_FAILURE;
+    }
+    if(!transferFully(server, &length, sizeof(length), 1) || !transferFully(server, request, length, 1)
+       || !transferFully(server, &reply, sizeof(reply), 0)){
+        fprintf(stderr,"The server closed the connection\n");
+        close(server);
+        return EXIT_FAILURE;
+    }
+    close(server);
+    if(reply.status){
+        fprintf(stderr,"The job failed, see the server's log\n");
+        return EXIT_FAILURE;
+    }
+    if(!reply.segment[0])
+        return EXIT_SUCCESS;
+
+    //the images are read in place from the segment, which is removed once mapped
+    reply.segment[sizeof(reply.segment) - 1] = '\0';
+    const int fd = shm_open(reply.segment, O_RDONLY, 0);
+    struct stat info;
+    void *segment = fd < 0 || fstat(fd, &info) ? MAP_FAILED : mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if(fd >= 0)
+        close(fd);
+    shm_unlink(reply.segment);
+    if(segment == MAP_FAILED){
+        perror(reply.segment);
+        return EXIT_FAILURE;
+    }
+    const struct resultHeader *header = (const struct resultHeader*)segment;
+    const int printed = printPGM((double*)(header + 1), header->width, header->height, header->nImages, header->min, header->max);
+    munmap(segment, info.st_size);
+    return printed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    struct runOptions o;
+    struct imageStack images;
+
+#ifdef __linux__
+    //server and client modes, the client sends the remaining arguments as a job
+    if(argc > 2 && !strcmp(argv[1], "--serve")){
+        return serve(argv[2]);
+    }
+    if(argc > 2 && !strcmp(argv[1], "--client")){
+        const char *socketPath = argv[2];
+        argv[2] = argv[0];
+        return runClient(socketPath, argc - 2, argv + 2);
+    }
+#endif
+
+    resetOptions(&o);
+    if(!parseOptions(argc, argv, &o) || !setupGeometry(&o) || !runProjector(&o, &images)){
+        freeScene();
+        freeWarmBuffers();
+        closePublication();
+        return EXIT_FAILURE;
     }
 
-    free(f);
-    free(absorbment);
+    //iterates over each absorption value computed, prints a value between [0-255]
+    int status = EXIT_SUCCESS;
+    if(images.values){
+        PROFILE_BEGIN(outputStart);
+        startCounters();
+        if(!printPGM(images.values, images.width, images.height, images.nImages, images.min, images.max))
+            status = EXIT_FAILURE;
+        stopCounters(STAGE_OUTPUT);
+        PROFILE_END(STAGE_OUTPUT, outputStart);
+    }
+
+    if(counters){
+        fprintf(stderr,"Output counters:\n");
+        reportCounters(STAGE_OUTPUT, 0);
+        closeCounters();
+    }
+
+#ifdef PROFILE
+    if(o.tracePath && !writeTrace(o.tracePath)){
+        return EXIT_FAILURE;
+    }
+#endif
 
+    freeScene();
+    free(yPlaneCoordinates);
+    freeWarmBuffers();
+    closePublication();
+    return status;
 }